@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <math.h>
+
+#include "FFT.h"
+
+////////////////////////////////////////////////////////////////////////////////////
+// constructor and destructor
+////////////////////////////////////////////////////////////////////////////////////
+FFT::FFT(){}
+
+FFT::~FFT(){}
+
+////////////////////////////////////////////////////////////////////////////////////
+// smallest power of two >= n
+////////////////////////////////////////////////////////////////////////////////////
+int FFT::nextPowerOfTwo(int n)
+{
+    int power = 1;
+    while (power < n)
+        power <<= 1;
+    return power;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// tables are computed once per transform length
+////////////////////////////////////////////////////////////////////////////////////
+const FFT::Tables &FFT::getTables(int n)
+{
+    std::map<int, Tables>::iterator it = tables.find(n);
+    if (it != tables.end())
+        return it->second;
+
+    Tables &t = tables[n];
+
+    int bits = 0;
+    while ((1 << bits) < n)
+        ++bits;
+
+    t.bitReversed.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b)
+        {
+            if (i & (1 << b))
+                reversed |= 1 << (bits - 1 - b);
+        }
+        t.bitReversed[i] = reversed;
+    }
+
+    t.twiddles.resize(n / 2 > 0 ? n / 2 : 1);
+    for (int k = 0; k < n / 2; ++k)
+    {
+        double phi = -2.0 * CV_PI * k / n;
+        t.twiddles[k] = std::complex<float>(float(cos(phi)), float(sin(phi)));
+    }
+
+    return t;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// 1D in-place complex FFT (iterative radix 2); the inverse is not scaled
+////////////////////////////////////////////////////////////////////////////////////
+void FFT::transform(std::complex<float> *data, int n, bool inverse)
+{
+    const Tables &t = getTables(n);
+
+    for (int i = 0; i < n; ++i)
+    {
+        int j = t.bitReversed[i];
+        if (i < j)
+            std::swap(data[i], data[j]);
+    }
+
+    for (int length = 2; length <= n; length <<= 1)
+    {
+        int half = length / 2;
+        int step = n / length;
+
+        for (int start = 0; start < n; start += length)
+        {
+            for (int k = 0; k < half; ++k)
+            {
+                std::complex<float> w = t.twiddles[k * step];
+                if (inverse)
+                    w = std::conj(w);
+
+                std::complex<float> a = data[start + k];
+                std::complex<float> b = data[start + k + half] * w;
+
+                data[start + k] = a + b;
+                data[start + k + half] = a - b;
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// transform all stored columns (0 .. width/2); every column is copied to a
+// contiguous buffer first
+////////////////////////////////////////////////////////////////////////////////////
+void FFT::transformColumns(std::vector<std::complex<float> > &spectrum, int height, int width, bool inverse)
+{
+    int halfWidth = width / 2 + 1;
+    scratch.resize(height);
+    std::complex<float> *column = &scratch[0];
+
+    for (int v = 0; v < halfWidth; ++v)
+    {
+        for (int u = 0; u < height; ++u)
+            column[u] = spectrum[u * halfWidth + v];
+
+        transform(column, height, inverse);
+
+        for (int u = 0; u < height; ++u)
+            spectrum[u * halfWidth + v] = column[u];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// forward transform of a real (CV_32F) image, zero padded to height x width
+//
+// two real rows a and b are transformed at once as z = a + i*b and separated
+// afterwards: A[k] = (Z[k] + conj(Z[-k])) / 2, B[k] = (Z[k] - conj(Z[-k])) / 2i
+////////////////////////////////////////////////////////////////////////////////////
+void FFT::forward(const cv::Mat &input, int height, int width, std::vector<std::complex<float> > &spectrum)
+{
+    int rows = std::min(input.rows, height);
+    int cols = std::min(input.cols, width);
+    int halfWidth = width / 2 + 1;
+
+    spectrum.assign(height * halfWidth, std::complex<float>(0.0f, 0.0f));
+    scratch.resize(width);
+    std::complex<float> *z = &scratch[0];
+
+    // rows beyond the image are zero, their spectrum stays zero
+    for (int r = 0; r < rows; r += 2)
+    {
+        const float *pA = input.ptr<float>(r);
+        const float *pB = (r + 1 < rows) ? input.ptr<float>(r + 1) : 0;
+
+        for (int c = 0; c < cols; ++c)
+            z[c] = std::complex<float>(pA[c], pB ? pB[c] : 0.0f);
+        for (int c = cols; c < width; ++c)
+            z[c] = std::complex<float>(0.0f, 0.0f);
+
+        transform(z, width, false);
+
+        std::complex<float> *pSpectrumA = &spectrum[r * halfWidth];
+        std::complex<float> *pSpectrumB = (r + 1 < height) ? &spectrum[(r + 1) * halfWidth] : 0;
+
+        for (int k = 0; k < halfWidth; ++k)
+        {
+            std::complex<float> zk = z[k];
+            std::complex<float> zn = std::conj(z[(width - k) % width]);
+
+            pSpectrumA[k] = 0.5f * (zk + zn);
+            if (pSpectrumB)
+                pSpectrumB[k] = std::complex<float>(0.0f, -0.5f) * (zk - zn);
+        }
+    }
+
+    transformColumns(spectrum, height, width, false);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// inverse transform to a real (CV_32F) height x width image, scaled by
+// 1 / (height * width); the spectrum is overwritten
+////////////////////////////////////////////////////////////////////////////////////
+void FFT::inverse(std::vector<std::complex<float> > &spectrum, int height, int width, cv::Mat &output)
+{
+    int halfWidth = width / 2 + 1;
+    float scale = 1.0f / (float(height) * float(width));
+
+    transformColumns(spectrum, height, width, true);
+
+    output.create(height, width, CV_32F);
+    scratch.resize(width);
+    std::complex<float> *z = &scratch[0];
+    const std::complex<float> i(0.0f, 1.0f);
+
+    // every row has a Hermitian spectrum again: rebuild the full spectra of two
+    // rows and transform them together as z = a + i*b
+    for (int r = 0; r < height; r += 2)
+    {
+        const std::complex<float> *pA = &spectrum[r * halfWidth];
+        const std::complex<float> *pB = (r + 1 < height) ? &spectrum[(r + 1) * halfWidth] : 0;
+
+        for (int k = 0; k < width; ++k)
+        {
+            std::complex<float> a = (k < halfWidth) ? pA[k] : std::conj(pA[width - k]);
+            std::complex<float> b(0.0f, 0.0f);
+            if (pB)
+                b = (k < halfWidth) ? pB[k] : std::conj(pB[width - k]);
+
+            z[k] = a + i * b;
+        }
+
+        transform(z, width, true);
+
+        float *pOutputA = output.ptr<float>(r);
+        float *pOutputB = pB ? output.ptr<float>(r + 1) : 0;
+
+        for (int c = 0; c < width; ++c)
+        {
+            pOutputA[c] = z[c].real() * scale;
+            if (pOutputB)
+                pOutputB[c] = z[c].imag() * scale;
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <map>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////
+// self-contained 2D FFT for real images (radix 2, sizes are powers of two)
+//
+// a real image of height x width has a Hermitian spectrum, so only the columns
+// 0 .. width/2 are stored: spectrum[u * (width/2 + 1) + v]
+////////////////////////////////////////////////////////////////////////////////////
+class FFT
+{
+public:
+    FFT();
+    ~FFT();
+
+    void forward(const cv::Mat &input, int height, int width, std::vector<std::complex<float> > &spectrum);
+    void inverse(std::vector<std::complex<float> > &spectrum, int height, int width, cv::Mat &output);
+
+    static int nextPowerOfTwo(int n);
+
+private:
+    // bit reversal permutation and twiddle factors for one transform length
+    struct Tables
+    {
+        std::vector<int> bitReversed;
+        std::vector<std::complex<float> > twiddles;
+    };
+    std::map<int, Tables> tables;
+
+    // row / column buffer, kept between calls
+    std::vector<std::complex<float> > scratch;
+
+    const Tables &getTables(int n);
+    void transform(std::complex<float> *data, int n, bool inverse);
+    void transformColumns(std::vector<std::complex<float> > &spectrum, int height, int width, bool inverse);
+};
+
+#endif /* FFT_H */
@@ -1,10 +1,22 @@
 #include <iostream>
 #include <math.h>
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
 #include "Filter.h"
+#include "Parallel.h"
 
 ////////////////////////////////////////////////////////////////////////////////////
 // constructor. Initialize the kernels
@@ -72,10 +84,36 @@ Filter::Filter()
                               2,  8,  12,  8,  2};
 
     Sobel5_Y = cv::Mat(5, 5, CV_8S, kernelS4).clone();
+
+    gaussianIIRThreshold = 2.0;
+
+    fftHeight = 0;
+    fftWidth = 0;
+
+    gaussianSigma = 0.0;
+
+    convolution3x3Engine = Convolution3x3Engine::Direct;
+
+    workspace = 0;
 }
 
 Filter::~Filter(){}
 
+void Filter::setWorkspace(Workspace *workspace)
+{
+    this->workspace = workspace;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// temporary image from the workspace (or a new one without a workspace)
+///////////////////////////////////////////////////////////////////////////////
+cv::Mat Filter::temporary(int rows, int cols, int type)
+{
+    if (workspace)
+        return workspace->acquire(rows, cols, type);
+    return cv::Mat(rows, cols, type);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////
 // convolve the image with the kernel using the OpenCV function - only for reference
 ////////////////////////////////////////////////////////////////////////////////////
@@ -131,12 +169,18 @@ void Filter::convolve_3x3(const cv::Mat &input, cv::Mat &output, const cv::Mat &
         return;
     }
 
+    if (convolution3x3Engine == Convolution3x3Engine::Winograd)
+    {
+        convolve_winograd(input, output, kernel);
+        return;
+    }
+
     int rows = input.rows;
     int cols = input.cols;
 
-    output.release();
-    // create a float image initialized with zeros
-    output = cv::Mat::zeros(rows, cols, CV_32F);
+    // only the one pixel wide border is not written by the convolution
+    Workspace::prepareOutput(input, output, rows, cols, CV_32F);
+    Workspace::clearBorder(output, 1, 1, 1, 1);
 
     int kRows = kernel.rows;
     int kCols = kernel.cols;
@@ -201,8 +245,60 @@ void Filter::convolve_3x3(const cv::Mat &input, cv::Mat &output, const cv::Mat &
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// direct convolution with cropped edges (kernel type K: signed char or float)
+///////////////////////////////////////////////////////////////////////////////
+template <typename K>
+static void convolveDirect(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel, float normFactor)
+{
+    int rows = input.rows;
+    int cols = input.cols;
+
+    int kRows = kernel.rows;
+    int kCols = kernel.cols;
+
+    int kHotspotX = kCols / 2;
+    int kHotspotY = kRows / 2;
+
+    // perform convolution
+    for (int r = 0; r < (rows - kRows + 1); ++r)
+    {
+        float *pOutput = output.ptr<float>(r + kHotspotY) + kHotspotX;
+
+        for (int c = 0; c < (cols - kCols + 1); ++c)
+        {
+            float result = 0.0f;
+
+            for (int kr = 0; kr < kRows; ++kr)
+            {
+                const float *pInput = input.ptr<float>(r + kr) + c;
+                const K *pKernel = kernel.ptr<K>(kr);
+
+                for (int kc = 0; kc < kCols; ++kc)
+                {
+                    result += ((*pInput) * (*pKernel));
+
+                    ++pKernel;
+                    ++pInput;
+                }
+            }
+
+            result /= normFactor;
+
+            *pOutput = result;
+
+            ++pOutput;
+        }
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // convolve the image with any filter kernel using pointer access
+//
+// CV_8S kernels are normalized by the sum of their absolute values, CV_32F
+// kernels are applied as they are. Separable (rank 1) 2D kernels are detected
+// and applied as two 1D passes (kRows + kCols instead of kRows * kCols
+// multiplications per pixel)
 ///////////////////////////////////////////////////////////////////////////////
 void Filter::convolve_generic(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
 {
@@ -211,13 +307,20 @@ void Filter::convolve_generic(const cv::Mat &input, cv::Mat &output, const cv::M
         std::cout << "One ore more inputs are empty!" << std::endl;
         return;
     }
+
+    if (kernel.type() != CV_8S && kernel.type() != CV_32F)
+    {
+        std::cout << "Kernel type is not supported (use CV_8S or CV_32F)!" << std::endl;
+        return;
+    }
     
     int rows = input.rows;
     int cols = input.cols;
     
-    output.release();
-    // create a float image initialized with zeros
-    output = cv::Mat::zeros(rows, cols, CV_32F); 
+    // the convolution writes every pixel except the cropped edges
+    Workspace::prepareOutput(input, output, rows, cols, CV_32F);
+    Workspace::clearBorder(output, kernel.rows / 2, kernel.rows - 1 - kernel.rows / 2,
+                           kernel.cols / 2, kernel.cols - 1 - kernel.cols / 2);
 
     int kRows = kernel.rows;
     int kCols = kernel.cols;
@@ -231,56 +334,371 @@ void Filter::convolve_generic(const cv::Mat &input, cv::Mat &output, const cv::M
     // calculate the normalisation factor from the filter kernel
     int normFactor = 0;
 
-    for (int r = 0; r < kRows; ++r)
+    if (kernel.type() == CV_8S)
     {
-        const signed char *pKernel = kernel.ptr<signed char>(r);
-        
-        for (int c = 0; c < kCols; ++c)
+        for (int r = 0; r < kRows; ++r)
         {
-            normFactor += abs(*pKernel);
-            ++pKernel;
+            const signed char *pKernel = kernel.ptr<signed char>(r);
+
+            for (int c = 0; c < kCols; ++c)
+            {
+                normFactor += abs(*pKernel);
+                ++pKernel;
+            }
+        }
+    }
+    else
+    {
+        normFactor = 1;
+    }
+
+    // use two 1D passes if the kernel is separable
+    if (kernel.rows > 1 && kernel.cols > 1)
+    {
+        const SeparableKernel &separated = analyzeKernel(kernel, float(normFactor));
+
+        if (separated.separable)
+        {
+            convolve_generic_separable(input, output, separated);
+            return;
         }
     }
 
     // perform a generic convolution with cropped edges
-    kRows = kernel.rows;
-    kCols = kernel.cols;
+    if (kernel.type() == CV_8S)
+        convolveDirect<signed char>(input, output, kernel, float(normFactor));
+    else
+        convolveDirect<float>(input, output, kernel, float(normFactor));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// test whether a kernel is the outer product of a column and a row vector
+// (rank 1). CV_8S kernels are tested exactly with integer arithmetic,
+// CV_32F kernels with a singular value decomposition
+///////////////////////////////////////////////////////////////////////////////
+const Filter::SeparableKernel &Filter::analyzeKernel(const cv::Mat &kernel, float normFactor)
+{
+    int kRows = kernel.rows;
+    int kCols = kernel.cols;
+    size_t rowBytes = kCols * kernel.elemSize();
+
+    // already analyzed?
+    for (size_t i = 0; i < separableCache.size(); ++i)
+    {
+        const cv::Mat &cached = separableCache[i].kernel;
+
+        if (cached.type() != kernel.type() || cached.rows != kRows || cached.cols != kCols)
+            continue;
+
+        bool equal = true;
+        for (int r = 0; r < kRows && equal; ++r)
+            equal = memcmp(cached.ptr(r), kernel.ptr(r), rowBytes) == 0;
+
+        if (equal)
+            return separableCache[i];
+    }
+
+    SeparableKernel entry;
+    entry.kernel = kernel.clone();
+    entry.separable = false;
+    entry.horizontal = cv::Mat(1, kCols, CV_32F);
+    entry.vertical = cv::Mat(kRows, 1, CV_32F);
+
+    if (kernel.type() == CV_8S)
+    {
+        // pivot: the element with the largest absolute value
+        int pivotRow = 0, pivotCol = 0, pivot = 0;
+        for (int r = 0; r < kRows; ++r)
+        {
+            const signed char *pKernel = kernel.ptr<signed char>(r);
+            for (int c = 0; c < kCols; ++c)
+            {
+                if (abs(pKernel[c]) > abs(pivot))
+                {
+                    pivot = pKernel[c];
+                    pivotRow = r;
+                    pivotCol = c;
+                }
+            }
+        }
+
+        // rank 1 <=> k(r,c) * k(pr,pc) == k(r,pc) * k(pr,c) for all elements
+        bool separable = pivot != 0;
+        const signed char *pPivotRow = kernel.ptr<signed char>(pivotRow);
+        for (int r = 0; r < kRows && separable; ++r)
+        {
+            const signed char *pKernel = kernel.ptr<signed char>(r);
+            for (int c = 0; c < kCols; ++c)
+            {
+                if (int(pKernel[c]) * pivot != int(pKernel[pivotCol]) * int(pPivotRow[c]))
+                {
+                    separable = false;
+                    break;
+                }
+            }
+        }
+
+        if (separable)
+        {
+            for (int c = 0; c < kCols; ++c)
+                entry.horizontal.at<float>(0, c) = float(pPivotRow[c]);
+
+            for (int r = 0; r < kRows; ++r)
+                entry.vertical.at<float>(r, 0) = float(kernel.at<signed char>(r, pivotCol)) / (pivot * normFactor);
+
+            entry.separable = true;
+        }
+    }
+    else
+    {
+        cv::Mat w, u, vt;
+        cv::SVD::compute(kernel, w, u, vt);
+
+        float s0 = w.at<float>(0, 0);
+        float s1 = w.rows > 1 ? w.at<float>(1, 0) : 0.0f;
+
+        if (s0 > 0.0f && s1 <= 1e-6f * s0)
+        {
+            float scale = sqrt(s0);
+
+            for (int c = 0; c < kCols; ++c)
+                entry.horizontal.at<float>(0, c) = vt.at<float>(0, c) * scale;
+
+            for (int r = 0; r < kRows; ++r)
+                entry.vertical.at<float>(r, 0) = u.at<float>(r, 0) * scale / normFactor;
+
+            entry.separable = true;
+        }
+    }
+
+    // keep the cache small; callers use only a few different kernels
+    if (separableCache.size() >= 32)
+        separableCache.erase(separableCache.begin());
+
+    separableCache.push_back(entry);
+    return separableCache.back();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// convolution with a separated kernel: horizontal pass, then vertical pass;
+// same cropped edges as convolve_generic
+///////////////////////////////////////////////////////////////////////////////
+void Filter::convolve_generic_separable(const cv::Mat &input, cv::Mat &output, const SeparableKernel &separated)
+{
+    int rows = input.rows;
+    int cols = input.cols;
+
+    int kRows = separated.vertical.rows;
+    int kCols = separated.horizontal.cols;
 
     int kHotspotX = kCols / 2;
     int kHotspotY = kRows / 2;
 
-    // perform convolution
-    for (int r = 0; r < (rows - kRows + 1); ++r)
+    int outRows = rows - kRows + 1;
+    int outCols = cols - kCols + 1;
+
+    if (outRows <= 0 || outCols <= 0)
+        return;
+
+    const float *pKernelH = separated.horizontal.ptr<float>(0);
+
+    // horizontal pass for every input row
+    cv::Mat horizontal = temporary(rows, outCols, CV_32F);
+    for (int r = 0; r < rows; ++r)
     {
-        float *pOutput = output.ptr<float>(r + kHotspotY) + kHotspotX;
+        const float *pInput = input.ptr<float>(r);
+        float *pHorizontal = horizontal.ptr<float>(r);
 
-        for (int c = 0; c < (cols - kCols + 1); ++c)
+        for (int c = 0; c < outCols; ++c)
         {
             float result = 0.0f;
 
-            for (int kr = 0; kr < kRows; ++kr)
-            {
-                const float *pInput = input.ptr<float>(r + kr) + c;
-                const signed char *pKernel = kernel.ptr<signed char>(kr);
+            for (int kc = 0; kc < kCols; ++kc)
+                result += pInput[c + kc] * pKernelH[kc];
 
-                for (int kc = 0; kc < kCols; ++kc)
-                {
-                    result += ((*pInput) * (*pKernel));
+            pHorizontal[c] = result;
+        }
+    }
 
-                    ++pKernel;
-                    ++pInput;
-                }
-            }
+    // vertical pass: accumulate whole rows (the first row initializes the output)
+    for (int r = 0; r < outRows; ++r)
+    {
+        float *pOutput = output.ptr<float>(r + kHotspotY) + kHotspotX;
 
-            result /= normFactor;
+        const float *pFirst = horizontal.ptr<float>(r);
+        float firstWeight = separated.vertical.at<float>(0, 0);
 
-            *pOutput = result;
+        for (int c = 0; c < outCols; ++c)
+            pOutput[c] = pFirst[c] * firstWeight;
 
-            ++pOutput;
+        for (int kr = 1; kr < kRows; ++kr)
+        {
+            const float *pHorizontal = horizontal.ptr<float>(r + kr);
+            float weight = separated.vertical.at<float>(kr, 0);
+
+            for (int c = 0; c < outCols; ++c)
+                pOutput[c] += pHorizontal[c] * weight;
         }
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// normalisation used by the convolve_* functions: CV_8S kernels are divided
+// by the sum of their absolute values, CV_32F kernels are used as they are
+///////////////////////////////////////////////////////////////////////////////
+float Filter::kernelNormFactor(const cv::Mat &kernel)
+{
+    if (kernel.type() != CV_8S)
+        return 1.0f;
+
+    int normFactor = 0;
+    for (int r = 0; r < kernel.rows; ++r)
+    {
+        const signed char *pKernel = kernel.ptr<signed char>(r);
+
+        for (int c = 0; c < kernel.cols; ++c)
+            normFactor += abs(pKernel[c]);
+    }
+
+    return float(normFactor);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// convolve the image in the frequency domain; same cropped edges and
+// normalisation as convolve_generic, but the cost does not depend on the
+// kernel size. The spectrum of the last kernel is kept for the next call
+///////////////////////////////////////////////////////////////////////////////
+void Filter::convolve_fft(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    if (input.empty() || kernel.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (kernel.type() != CV_8S && kernel.type() != CV_32F)
+    {
+        std::cout << "Kernel type is not supported (use CV_8S or CV_32F)!" << std::endl;
+        return;
+    }
+
+    int rows = input.rows;
+    int cols = input.cols;
+    int kRows = kernel.rows;
+    int kCols = kernel.cols;
+
+    // only the valid part is written below
+    int kHotspotX = kCols / 2;
+    int kHotspotY = kRows / 2;
+    int outRows = std::max(rows - kRows + 1, 0);
+    int outCols = std::max(cols - kCols + 1, 0);
+
+    Workspace::prepareOutput(input, output, rows, cols, CV_32F);
+    Workspace::clearBorder(output, kHotspotY, rows - kHotspotY - outRows, kHotspotX, cols - kHotspotX - outCols);
+
+    if (outRows == 0 || outCols == 0)
+        return;
+
+    // the valid part of a correlation never wraps around if the transform is
+    // at least as large as the image
+    int height = FFT::nextPowerOfTwo(rows);
+    int width = std::max(FFT::nextPowerOfTwo(cols), 2);
+
+    // kernel spectrum (reused if kernel and transform size did not change)
+    bool sameKernel = height == fftHeight && width == fftWidth && fftKernel.type() == kernel.type()
+                      && fftKernel.rows == kRows && fftKernel.cols == kCols;
+    for (int r = 0; r < kRows && sameKernel; ++r)
+        sameKernel = memcmp(fftKernel.ptr(r), kernel.ptr(r), kCols * kernel.elemSize()) == 0;
+
+    if (!sameKernel)
+    {
+        cv::Mat floatKernel;
+        kernel.convertTo(floatKernel, CV_32F, 1.0 / kernelNormFactor(kernel));
+        fft.forward(floatKernel, height, width, fftKernelSpectrum);
+
+        fftKernel = kernel.clone();
+        fftHeight = height;
+        fftWidth = width;
+    }
+
+    // correlation: multiply with the conjugated kernel spectrum
+    cv::Mat floatInput;
+    if (input.type() == CV_32F)
+        floatInput = input;
+    else
+    {
+        floatInput = temporary(input.rows, input.cols, CV_32F);
+        input.convertTo(floatInput, CV_32F);
+    }
+
+    fft.forward(floatInput, height, width, fftSpectrum);
+
+    for (size_t i = 0; i < fftSpectrum.size(); ++i)
+        fftSpectrum[i] *= std::conj(fftKernelSpectrum[i]);
+
+    fft.inverse(fftSpectrum, height, width, fftCorrelation);
+
+    // copy the valid part to the kernel's hotspot position
+    for (int r = 0; r < outRows; ++r)
+    {
+        const float *pCorrelation = fftCorrelation.ptr<float>(r);
+        float *pOutput = output.ptr<float>(r + kHotspotY) + kHotspotX;
+
+        memcpy(pOutput, pCorrelation, outCols * sizeof(float));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// choose the cheapest convolution algorithm from kernel and image size
+// (rough operation counts: multiply-adds per pixel for the spatial methods,
+// two real 2D transforms plus the spectrum product for the FFT)
+///////////////////////////////////////////////////////////////////////////////
+ConvolutionMethod Filter::selectConvolution(const cv::Mat &input, const cv::Mat &kernel)
+{
+    double pixels = double(input.rows) * double(input.cols);
+    double kRows = kernel.rows;
+    double kCols = kernel.cols;
+
+    double costDirect = pixels * kRows * kCols;
+    double costSeparable = costDirect;
+
+    if (kernel.rows > 1 && kernel.cols > 1 && (kernel.type() == CV_8S || kernel.type() == CV_32F))
+    {
+        if (analyzeKernel(kernel, kernelNormFactor(kernel)).separable)
+            costSeparable = pixels * (kRows + kCols);
+    }
+
+    double height = FFT::nextPowerOfTwo(input.rows);
+    double width = FFT::nextPowerOfTwo(input.cols);
+    double transformSize = height * width;
+    // a real transform costs about half of a complex one (5 N log2 N flops)
+    double costFFT = 2.0 * 2.5 * transformSize * log2(transformSize) + 6.0 * transformSize / 2.0;
+
+    if (costFFT < costSeparable && costFFT < costDirect)
+        return ConvolutionMethod::FFT;
+    if (costSeparable < costDirect)
+        return ConvolutionMethod::Separable;
+    return ConvolutionMethod::Direct;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// convolve with the algorithm chosen by selectConvolution
+///////////////////////////////////////////////////////////////////////////////
+void Filter::convolve_auto(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    if (input.empty() || kernel.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    // convolve_generic routes separable kernels by itself
+    if (selectConvolution(input, kernel) == ConvolutionMethod::FFT)
+        convolve_fft(input, output, kernel);
+    else
+        convolve_generic(input, output, kernel);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // extrapolate the image's borders and perform convolution
 ///////////////////////////////////////////////////////////////////////////////
@@ -299,7 +717,7 @@ void Filter::convolve_extrapolate(const cv::Mat &input, cv::Mat &output, const c
     int cOffset = cols + border;
 
     // create new Mat to hold the extrapolated image
-    cv::Mat extrapolated(rows + 2 * border, cols + 2 * border, input.type());
+    cv::Mat extrapolated = temporary(rows + 2 * border, cols + 2 * border, input.type());
 
     // define a ROI and copy input image to it
     cv::Rect ROI(border, border, cols, rows);
@@ -343,7 +761,7 @@ void Filter::convolve_extrapolate(const cv::Mat &input, cv::Mat &output, const c
     }
 
     // do the convolution with the extrapolated image
-    cv::Mat extrapolatedOutput;
+    cv::Mat extrapolatedOutput = temporary(extrapolated.rows, extrapolated.cols, CV_32F);
     convolve_generic(extrapolated, extrapolatedOutput, kernel);
 
     // discard the border pixels and copy the result to the output image
@@ -364,9 +782,8 @@ void Filter::getAbsOfSobel(const cv::Mat &input_1, const cv::Mat &input_2, cv::M
     int rows = input_1.rows;
     int cols = input_1.cols;
 
-    output.release();
-    // create a float image initialized with zeros
-    output = cv::Mat::zeros(rows, cols, CV_32F);
+    // every pixel is written, no zero-fill needed
+    output.create(rows, cols, CV_32F);
     
     // calculate the abs() of the x-Sobel and y-Sobel results
     for (int r = 0; r < rows; ++r)
@@ -377,7 +794,7 @@ void Filter::getAbsOfSobel(const cv::Mat &input_1, const cv::Mat &input_2, cv::M
         
         for (int c = 0; c < cols; ++c)
         {
-            *pOutput = sqrt( pow(*pInput_1, 2) + pow(*pInput_2, 2) );
+            *pOutput = sqrt( (*pInput_1) * (*pInput_1) + (*pInput_2) * (*pInput_2) );
 
             ++pInput_1;
             ++pInput_2;
@@ -387,21 +804,277 @@ void Filter::getAbsOfSobel(const cv::Mat &input_1, const cv::Mat &input_2, cv::M
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// compute a binomial kernel
+// helpers for the fused gradient operator
 ///////////////////////////////////////////////////////////////////////////////
-cv::Mat Filter::calcBinomial(uchar size)
+
+// sqrt(x) = x * rsqrt(x); the reciprocal square root is estimated from the
+// bit pattern of the float and refined by two Newton iterations
+static inline float fastSqrt(float x)
 {
-    cv::Mat series(size, 1, CV_8S);
-    cv::Mat kernel(size, size, CV_8S);
+    if (x <= 0.0f)
+        return 0.0f;
 
-    uchar order = size - 1;
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5f3759df - (bits >> 1);
 
-    // calculate a series of binomial coefficients
-    signed char *pSeries = series.ptr<signed char>(0);
-    for (int x = 0; x < size; ++x)
-    {
-        *pSeries = (signed char) calcBinomialCoefficient(order, x);
-        ++pSeries;
+    float y;
+    memcpy(&y, &bits, sizeof(y));
+
+    float halfX = 0.5f * x;
+    y = y * (1.5f - halfX * y * y);
+    y = y * (1.5f - halfX * y * y);
+
+    return x * y;
+}
+
+static inline float gradientMagnitude(float gx, float gy, GradientMagnitude kind)
+{
+    switch (kind)
+    {
+    case GradientMagnitude::L1:
+        return fabs(gx) + fabs(gy);
+
+    case GradientMagnitude::AlphaMaxBetaMin:
+    {
+        // alpha and beta with the smallest maximum error (about 4%)
+        float ax = fabs(gx);
+        float ay = fabs(gy);
+        float max = ax > ay ? ax : ay;
+        float min = ax > ay ? ay : ax;
+        return 0.96043387f * max + 0.39782473f * min;
+    }
+
+    default:
+        return fastSqrt(gx * gx + gy * gy);
+    }
+}
+
+// quantize the gradient direction into 4 sectors:
+// 0: horizontal, 1: diagonal (top left to bottom right),
+// 2: vertical,   3: diagonal (top right to bottom left)
+static inline uchar quantizeDirection(float gx, float gy)
+{
+    const float tan22_5 = 0.41421356f;
+    const float tan67_5 = 2.41421356f;
+
+    float ax = fabs(gx);
+    float ay = fabs(gy);
+
+    if (ay <= tan22_5 * ax)
+        return 0;
+    if (ay >= tan67_5 * ax)
+        return 2;
+
+    return ((gx > 0.0f) == (gy > 0.0f)) ? 1 : 3;
+}
+
+// 3x3 Sobel in x and y direction, magnitude and direction in a single pass;
+// the derivatives are normalized like convolve_3x3 does it (divided by 8).
+// Writes the columns 1 .. cols - 2 of one row
+template <typename T>
+static void sobelRow(const T *pInputAbove, const T *pInput, const T *pInputBelow, float *pMagnitude,
+                     uchar *pDirection, int cols, GradientMagnitude kind)
+{
+    ++pMagnitude;
+    if (pDirection)
+        ++pDirection;
+
+    for (int c = 1; c < (cols - 1); ++c)
+    {
+        float a0 = pInputAbove[c - 1], a1 = pInputAbove[c], a2 = pInputAbove[c + 1];
+        float b0 = pInput[c - 1],                           b2 = pInput[c + 1];
+        float c0 = pInputBelow[c - 1], c1 = pInputBelow[c], c2 = pInputBelow[c + 1];
+
+        float gx = ((a2 + 2.0f * b2 + c2) - (a0 + 2.0f * b0 + c0)) * 0.125f;
+        float gy = ((c0 + 2.0f * c1 + c2) - (a0 + 2.0f * a1 + a2)) * 0.125f;
+
+        *pMagnitude = gradientMagnitude(gx, gy, kind);
+        ++pMagnitude;
+
+        if (pDirection)
+        {
+            *pDirection = quantizeDirection(gx, gy);
+            ++pDirection;
+        }
+    }
+}
+
+template <typename T>
+static void sobelGradient(const cv::Mat &input, cv::Mat &magnitude, cv::Mat *direction, GradientMagnitude kind,
+                          int rowBegin, int rowEnd)
+{
+    for (int r = rowBegin; r < rowEnd; ++r)
+    {
+        sobelRow<T>(input.ptr<T>(r - 1), input.ptr<T>(r), input.ptr<T>(r + 1), magnitude.ptr<float>(r),
+                    direction ? direction->ptr<uchar>(r) : 0, input.cols, kind);
+    }
+}
+
+// same for 16 bit intermediates and half precision images: the rows are
+// converted to float on the way in (three row ring buffer) and on the way out
+template <typename Input, typename Magnitude>
+static void sobelGradientConverted(const Input &input, Magnitude &magnitude, cv::Mat *direction,
+                                   GradientMagnitude kind, int rowBegin, int rowEnd)
+{
+    int cols = storage(input).cols;
+    std::vector<float> ring(3 * cols), magnitudeRow(cols, 0.0f);
+    float *pRows[3] = { &ring[0], &ring[cols], &ring[2 * cols] };
+
+    loadRow(input, rowBegin - 1, pRows[0]);
+    loadRow(input, rowBegin, pRows[1]);
+
+    // only a cv::Mat magnitude can be CV_32F, HalfImage bits are CV_16U
+    bool floatMagnitude = storage(magnitude).type() == CV_32F;
+
+    for (int r = rowBegin; r < rowEnd; ++r)
+    {
+        loadRow(input, r + 1, pRows[2]);
+
+        float *pMagnitude = floatMagnitude ? storage(magnitude).template ptr<float>(r) : &magnitudeRow[0];
+
+        sobelRow<float>(pRows[0], pRows[1], pRows[2], pMagnitude,
+                        direction ? direction->ptr<uchar>(r) : 0, cols, kind);
+
+        // the border pixels of magnitudeRow stay zero
+        if (!floatMagnitude)
+            storeRow(pMagnitude, magnitude, r);
+
+        float *pOldest = pRows[0];
+        pRows[0] = pRows[1];
+        pRows[1] = pRows[2];
+        pRows[2] = pOldest;
+    }
+}
+
+// inputs the gradient accepts
+static bool isGradientInput(const cv::Mat &input)
+{
+    return isIntermediateType(input.type());
+}
+
+static bool isGradientInput(const HalfImage &input)
+{
+    return input.bits.type() == CV_16U;
+}
+
+// 16 bit outputs of the cv::Mat overloads are fixed point; half precision
+// outputs have their own HalfImage overloads
+static bool isOutputType(int type)
+{
+    return type == CV_32F || type == CV_16S;
+}
+
+template <typename Input, typename Magnitude>
+void Filter::gradient_3x3(const Input &input, Magnitude &magnitude, cv::Mat *direction, GradientMagnitude kind,
+                          int magnitudeType)
+{
+    const cv::Mat &inputData = storage(input);
+    cv::Mat &magnitudeData = storage(magnitude);
+
+    if (inputData.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (!isGradientInput(input))
+    {
+        std::cout << "Input type is not supported (use CV_8U, CV_16U, CV_32F or CV_16S)!" << std::endl;
+        return;
+    }
+
+    int rows = inputData.rows;
+    int cols = inputData.cols;
+
+    // the one pixel wide border stays zero
+    Workspace::prepareOutput(inputData, magnitudeData, rows, cols, magnitudeType);
+    Workspace::clearBorder(magnitudeData, 1, 1, 1, 1);
+
+    if (direction)
+    {
+        Workspace::prepareOutput(inputData, *direction, rows, cols, CV_8U);
+        Workspace::clearBorder(*direction, 1, 1, 1, 1);
+    }
+
+    // row bands in parallel; CV_8U and CV_32F inputs with a CV_32F magnitude
+    // are read directly
+    parallel_for(1, rows - 1, [&](int rowBegin, int rowEnd)
+    {
+        if (magnitudeType != CV_32F || (inputData.type() != CV_8U && inputData.type() != CV_32F))
+            sobelGradientConverted(input, magnitude, direction, kind, rowBegin, rowEnd);
+        else if (inputData.type() == CV_8U)
+            sobelGradient<uchar>(inputData, magnitudeData, direction, kind, rowBegin, rowEnd);
+        else
+            sobelGradient<float>(inputData, magnitudeData, direction, kind, rowBegin, rowEnd);
+    }, 32);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// compute the gradient magnitude with a 3x3 Sobel operator in one pass
+///////////////////////////////////////////////////////////////////////////////
+void Filter::gradient(const cv::Mat &input, cv::Mat &magnitude, GradientMagnitude kind, int magnitudeType)
+{
+    if (!isOutputType(magnitudeType))
+    {
+        std::cout << "Magnitude type is not supported (use CV_32F or CV_16S)!" << std::endl;
+        return;
+    }
+
+    gradient_3x3(input, magnitude, 0, kind, magnitudeType);
+}
+
+void Filter::gradient(const HalfImage &input, HalfImage &magnitude, GradientMagnitude kind)
+{
+    gradient_3x3(input, magnitude, 0, kind, CV_16U);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// compute gradient magnitude and quantized direction (CV_8U, values 0..3)
+// with a 3x3 Sobel operator in one pass
+///////////////////////////////////////////////////////////////////////////////
+void Filter::gradient(const cv::Mat &input, cv::Mat &magnitude, cv::Mat &direction, GradientMagnitude kind,
+                      int magnitudeType)
+{
+    if (!isOutputType(magnitudeType))
+    {
+        std::cout << "Magnitude type is not supported (use CV_32F or CV_16S)!" << std::endl;
+        return;
+    }
+
+    gradient_3x3(input, magnitude, &direction, kind, magnitudeType);
+}
+
+void Filter::gradient(const HalfImage &input, HalfImage &magnitude, cv::Mat &direction, GradientMagnitude kind)
+{
+    gradient_3x3(input, magnitude, &direction, kind, CV_16U);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// compute a binomial kernel
+///////////////////////////////////////////////////////////////////////////////
+cv::Mat Filter::calcBinomial(uchar size)
+{
+    // the largest tap is the square of the middle binomial coefficient
+    int largest = size > 0 ? calcBinomialCoefficient(size - 1, (size - 1) / 2) : 0;
+    if (size == 0 || largest * largest > 127)
+    {
+        std::cout << "Binomial kernel of size " << int(size) << " does not fit into CV_8S (use getBinomial1D)!"
+                  << std::endl;
+        return cv::Mat();
+    }
+
+    cv::Mat series(size, 1, CV_8S);
+    cv::Mat kernel(size, size, CV_8S);
+
+    uchar order = size - 1;
+
+    // calculate a series of binomial coefficients
+    signed char *pSeries = series.ptr<signed char>(0);
+    for (int x = 0; x < size; ++x)
+    {
+        *pSeries = (signed char) calcBinomialCoefficient(order, x);
+        ++pSeries;
     }
 
     // form the kernel as outer product
@@ -427,6 +1100,17 @@ cv::Mat Filter::calcBinomial(uchar size)
 ///////////////////////////////////////////////////////////////////////////////
 cv::Mat Filter::calcSobel(uchar size, bool transpose)
 {
+    // largest tap: binomial coefficient times distance from the center
+    int largest = 0;
+    for (int x = 0; x < size; ++x)
+        largest = std::max(largest, calcBinomialCoefficient(size - 1, x) * std::abs(x - size / 2));
+    if (size == 0 || largest > 127)
+    {
+        std::cout << "Sobel kernel of size " << int(size) << " does not fit into CV_8S (use getSobelDerivative1D)!"
+                  << std::endl;
+        return cv::Mat();
+    }
+
     signed char mean = (signed char) size / 2;
 
     cv::Mat binomial(size, 1, CV_8S);
@@ -483,17 +1167,7 @@ cv::Mat Filter::calcSobel(uchar size, bool transpose)
 ///////////////////////////////////////////////////////////////////////////////
 int Filter::calcBinomialCoefficient(int n, int k)
 {
-    if (( k == 0 ) || (n == k))
-    {
-        return 1;
-    }
-    else
-    {
-        // recursion
-        int tempN = calcBinomialCoefficient(n - 1, k);
-        int tempK = calcBinomialCoefficient(n - 1, k - 1);
-        return tempN + tempK;
-    }
+    return (int) kernels::binomialCoefficient(n, k);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -561,6 +1235,43 @@ cv::Mat Filter::getSobelY(uchar size)
         return cv::Mat();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// return a normalized Binomial kernel (1 x size, or size x 1) of any odd size
+///////////////////////////////////////////////////////////////////////////////
+cv::Mat Filter::getBinomial1D(int size, bool transpose)
+{
+    if (size < 1 || size % 2 == 0 || size > 61)
+        return cv::Mat();
+
+    cv::Mat kernel = transpose ? cv::Mat(size, 1, CV_32F) : cv::Mat(1, size, CV_32F);
+    float *pKernel = kernel.ptr<float>(0);
+    float sum = float(kernels::binomialSum(size));
+
+    for (int i = 0; i < size; ++i)
+        pKernel[i] = float(kernels::binomialCoefficient(size - 1, i)) / sum;
+
+    return kernel;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// return the normalized derivative part of a Sobel kernel of any odd size;
+// Sobel X = derivative (1 x size) combined with Binomial (size x 1)
+///////////////////////////////////////////////////////////////////////////////
+cv::Mat Filter::getSobelDerivative1D(int size, bool transpose)
+{
+    if (size < 3 || size % 2 == 0)
+        return cv::Mat();
+
+    cv::Mat kernel = transpose ? cv::Mat(size, 1, CV_32F) : cv::Mat(1, size, CV_32F);
+    float *pKernel = kernel.ptr<float>(0);
+    float sum = float(kernels::derivativeAbsSum(size));
+
+    for (int i = 0; i < size; ++i)
+        pKernel[i] = float(kernels::derivativeTap(size, i)) / sum;
+
+    return kernel;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // scale a Sobel image for better displaying
 ///////////////////////////////////////////////////////////////////////////////
@@ -573,3 +1284,1455 @@ void Filter::scaleSobelImage(const cv::Mat &input, cv::Mat &output)
     // scale the image
     input.convertTo(output, CV_32F, (0.5f / max), 0.5f);
 }
+
+
+///////////////////////////////////////////////////////////////////////////////
+// box filter (size x size) with running sums: the cost per pixel does not
+// depend on the kernel size; borders are replicated
+///////////////////////////////////////////////////////////////////////////////
+void Filter::boxFilter(const cv::Mat &input, cv::Mat &output, int size)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (size < 1 || size % 2 == 0)
+    {
+        std::cout << "Box filter size must be odd!" << std::endl;
+        return;
+    }
+
+    cv::Mat floatInput;
+    if (input.type() == CV_32F)
+        floatInput = input;
+    else
+    {
+        floatInput = temporary(input.rows, input.cols, CV_32F);
+        input.convertTo(floatInput, CV_32F);
+    }
+
+    int rows = floatInput.rows;
+    int cols = floatInput.cols;
+    int half = size / 2;
+    float scale = 1.0f / size;
+
+    // horizontal pass: slide a window over a replicate-padded copy of the row
+    cv::Mat horizontal = temporary(rows, cols, CV_32F);
+    std::vector<float> padded(cols + 2 * half);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        const float *pInput = floatInput.ptr<float>(r);
+        float *pOutput = horizontal.ptr<float>(r);
+
+        for (int c = 0; c < half; ++c)
+        {
+            padded[c] = pInput[0];
+            padded[cols + half + c] = pInput[cols - 1];
+        }
+        memcpy(&padded[half], pInput, cols * sizeof(float));
+
+        float sum = 0.0f;
+        for (int c = 0; c < size; ++c)
+            sum += padded[c];
+
+        for (int c = 0; c < cols; ++c)
+        {
+            pOutput[c] = sum * scale;
+            if (c + 1 < cols)
+                sum += padded[c + size] - padded[c];
+        }
+    }
+
+    // vertical pass: keep one running sum per column and move it down row by row
+    // (it reads only the horizontal pass, so the output may be the input)
+    output.create(rows, cols, CV_32F);
+
+    std::vector<float> columnSum(cols, 0.0f);
+
+    for (int k = -half; k <= half; ++k)
+    {
+        const float *pInput = horizontal.ptr<float>(std::min(std::max(k, 0), rows - 1));
+
+        for (int c = 0; c < cols; ++c)
+            columnSum[c] += pInput[c];
+    }
+
+    for (int r = 0; r < rows; ++r)
+    {
+        float *pOutput = output.ptr<float>(r);
+
+        for (int c = 0; c < cols; ++c)
+            pOutput[c] = columnSum[c] * scale;
+
+        if (r + 1 < rows)
+        {
+            const float *pAdd = horizontal.ptr<float>(std::min(r + half + 1, rows - 1));
+            const float *pRemove = horizontal.ptr<float>(std::max(r - half, 0));
+
+            for (int c = 0; c < cols; ++c)
+                columnSum[c] += pAdd[c] - pRemove[c];
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// approximate a Gaussian blur by repeated box filtering: the box sizes are
+// chosen so that the variance of the passes adds up to sigma^2
+// (P. Kovesi, "Fast Almost-Gaussian Filtering"); the cost per pixel does not
+// depend on sigma
+///////////////////////////////////////////////////////////////////////////////
+void Filter::gaussianBlurBox(const cv::Mat &input, cv::Mat &output, double sigma, int passes)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (sigma <= 0.0 || passes < 1)
+    {
+        input.convertTo(output, CV_32F);
+        return;
+    }
+
+    // ideal box width for n passes, rounded down to the next odd width
+    double idealWidth = sqrt(12.0 * sigma * sigma / passes + 1.0);
+    int lowerWidth = int(floor(idealWidth));
+    if (lowerWidth % 2 == 0)
+        --lowerWidth;
+    int upperWidth = lowerWidth + 2;
+
+    // number of passes with the smaller width
+    double idealCount = (12.0 * sigma * sigma - passes * lowerWidth * lowerWidth
+                         - 4.0 * passes * lowerWidth - 3.0 * passes) / (-4.0 * lowerWidth - 4.0);
+    int lowerCount = int(round(idealCount));
+
+    input.convertTo(output, CV_32F);
+
+    // boxFilter works in place
+    for (int i = 0; i < passes; ++i)
+        boxFilter(output, output, i < lowerCount ? lowerWidth : upperWidth);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// compute a normalized Gaussian kernel, separated into a horizontal (1 x size)
+// and a vertical (size x 1) kernel
+///////////////////////////////////////////////////////////////////////////////
+void Filter::setGaussianKernels1D(cv::Mat &kernelHorizontal, cv::Mat &kernelVertical, int size, const double sigma)
+{
+    kernelHorizontal.release();
+    kernelVertical.release();
+
+    int half = size / 2;
+
+    if (sigma <= 0.0)
+    {
+        kernelHorizontal = cv::Mat::zeros(1, size, CV_32F);
+        kernelHorizontal.at<float>(0, half) = 1.0f;
+
+        kernelVertical = cv::Mat::zeros(size, 1, CV_32F);
+        kernelVertical.at<float>(half, 0) = 1.0f;
+
+        return;
+    }
+
+    kernelHorizontal = cv::Mat(1, size, CV_32F);
+
+    double factor = -1.0 / (2.0 * sigma * sigma);
+
+    // horizontal kernel
+    float sum = 0.0f;
+    float *pKernel = kernelHorizontal.ptr<float>(0);
+    for (int i = 0; i < size; ++i)
+    {
+        double x = double(i - half);
+        float gauss = float(exp(x * x * factor));
+        sum += gauss;
+        pKernel[i] = gauss;
+    }
+
+    // normalize horizontal kernel
+    for (int i = 0; i < size; ++i)
+    {
+        pKernel[i] /= sum;
+    }
+
+    // vertical kernel: same values
+    kernelVertical = cv::Mat(size, 1, CV_32F, pKernel).clone();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// convolve the image with a separated float kernel (horizontal pass, then
+// vertical pass); the kernels are applied as they are, borders are replicated
+///////////////////////////////////////////////////////////////////////////////
+void Filter::convolve_separable(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernelHorizontal,
+                                const cv::Mat &kernelVertical, int outputType)
+{
+    if (!isOutputType(outputType))
+    {
+        std::cout << "Output type is not supported (use CV_32F or CV_16S)!" << std::endl;
+        return;
+    }
+
+    convolveSeparableTo(input, output, kernelHorizontal, kernelVertical, outputType);
+}
+
+void Filter::convolve_separable(const cv::Mat &input, HalfImage &output, const cv::Mat &kernelHorizontal,
+                                const cv::Mat &kernelVertical)
+{
+    convolveSeparableTo(input, output, kernelHorizontal, kernelVertical, CV_16U);
+}
+
+template <typename Output>
+void Filter::convolveSeparableTo(const cv::Mat &input, Output &output, const cv::Mat &kernelHorizontal,
+                                 const cv::Mat &kernelVertical, int outputType)
+{
+    if (input.empty() || kernelHorizontal.empty() || kernelVertical.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    cv::Mat floatInput;
+    if (input.type() == CV_32F)
+        floatInput = input;
+    else
+    {
+        floatInput = temporary(input.rows, input.cols, CV_32F);
+        input.convertTo(floatInput, CV_32F);
+    }
+
+    // both kernels may be given as row or column vector
+    cv::Mat kH = kernelHorizontal.isContinuous() ? kernelHorizontal : kernelHorizontal.clone();
+    cv::Mat kV = kernelVertical.isContinuous() ? kernelVertical : kernelVertical.clone();
+    int sizeH = int(kH.total());
+    int sizeV = int(kV.total());
+    int halfH = sizeH / 2;
+    int halfV = sizeV / 2;
+    const float *pKernelH = kH.ptr<float>(0);
+    const float *pKernelV = kV.ptr<float>(0);
+
+    int rows = floatInput.rows;
+    int cols = floatInput.cols;
+
+    // horizontal pass on a replicate-padded copy of every row
+    cv::Mat horizontal = temporary(rows, cols, CV_32F);
+    std::vector<float> padded(cols + 2 * halfH);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        const float *pInput = floatInput.ptr<float>(r);
+        float *pOutput = horizontal.ptr<float>(r);
+
+        for (int c = 0; c < halfH; ++c)
+        {
+            padded[c] = pInput[0];
+            padded[cols + halfH + c] = pInput[cols - 1];
+        }
+        memcpy(&padded[halfH], pInput, cols * sizeof(float));
+
+        for (int c = 0; c < cols; ++c)
+        {
+            const float *pPadded = &padded[c];
+            float result = 0.0f;
+
+            for (int k = 0; k < sizeH; ++k)
+                result += pPadded[k] * pKernelH[k];
+
+            pOutput[c] = result;
+        }
+    }
+
+    // vertical pass: accumulate whole rows, the border rows are replicated
+    // (the first tap initializes the output, so no zero-fill is needed).
+    // 16 bit outputs are accumulated in a float row and converted once
+    cv::Mat &outputData = storage(output);
+    outputData.create(rows, cols, outputType);
+    std::vector<float> outputRow(outputType == CV_32F ? 0 : cols);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        float *pOutput = outputType == CV_32F ? outputData.ptr<float>(r) : &outputRow[0];
+
+        const float *pFirst = horizontal.ptr<float>(std::max(r - halfV, 0));
+        for (int c = 0; c < cols; ++c)
+            pOutput[c] = pFirst[c] * pKernelV[0];
+
+        for (int k = 1; k < sizeV; ++k)
+        {
+            int inputRow = std::min(std::max(r + k - halfV, 0), rows - 1);
+            const float *pInput = horizontal.ptr<float>(inputRow);
+            float weight = pKernelV[k];
+
+            for (int c = 0; c < cols; ++c)
+                pOutput[c] += pInput[c] * weight;
+        }
+
+        if (outputType != CV_32F)
+            storeRow(pOutput, output, r);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Gaussian blur: separable FIR filter for small sigma, recursive filter for
+// large sigma (where the FIR kernel gets long)
+///////////////////////////////////////////////////////////////////////////////
+void Filter::gaussianBlur(const cv::Mat &input, cv::Mat &output, double sigma, int outputType)
+{
+    if (!isOutputType(outputType))
+    {
+        std::cout << "Output type is not supported (use CV_32F or CV_16S)!" << std::endl;
+        return;
+    }
+
+    gaussianBlurTo(input, output, sigma, outputType);
+}
+
+void Filter::gaussianBlur(const cv::Mat &input, HalfImage &output, double sigma)
+{
+    gaussianBlurTo(input, output, sigma, CV_16U);
+}
+
+template <typename Output>
+void Filter::gaussianBlurTo(const cv::Mat &input, Output &output, double sigma, int outputType)
+{
+    if (sigma > gaussianIIRThreshold)
+    {
+        gaussianBlurIIRTo(input, output, sigma, outputType);
+        return;
+    }
+
+    // the kernel covers +-3 sigma
+    int size = 2 * int(ceil(3.0 * sigma)) + 1;
+
+    // the kernels of the last sigma are kept for the next frame
+    if (sigma != gaussianSigma || gaussianKernelHorizontal.empty())
+    {
+        setGaussianKernels1D(gaussianKernelHorizontal, gaussianKernelVertical, size, sigma);
+        gaussianSigma = sigma;
+    }
+    convolveSeparableTo(input, output, gaussianKernelHorizontal, gaussianKernelVertical, outputType);
+}
+
+void Filter::setGaussianIIRThreshold(double sigma)
+{
+    gaussianIIRThreshold = sigma;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// initial values of the backward pass of the recursive Gaussian filter:
+// behind the last pixel the input is replicated, so the forward pass decays
+// from its last three values towards the border value. M maps these three
+// deviations onto the deviations of the first three backward values
+// (B. Triggs, M. Sdika, "Boundary conditions for Young - van Vliet recursive
+// filtering", 2006); here M is obtained by running both passes on unit states
+///////////////////////////////////////////////////////////////////////////////
+static void iirBorderMatrix(double B, double a1, double a2, double a3, double sigma, double M[3][3])
+{
+    int length = int(20.0 * sigma) + 64;
+    std::vector<double> e(length + 6, 0.0);
+    std::vector<double> d(length + 6, 0.0);
+
+    for (int j = 0; j < 3; ++j)
+    {
+        // e[3] is the first sample behind the border, e[2 - j] = 1 selects the state
+        std::fill(e.begin(), e.end(), 0.0);
+        std::fill(d.begin(), d.end(), 0.0);
+        e[2 - j] = 1.0;
+
+        for (int n = 3; n < length + 3; ++n)
+            e[n] = a1 * e[n - 1] + a2 * e[n - 2] + a3 * e[n - 3];
+
+        for (int n = length + 2; n >= 3; --n)
+            d[n] = B * e[n] + a1 * d[n + 1] + a2 * d[n + 2] + a3 * d[n + 3];
+
+        M[0][j] = d[3];
+        M[1][j] = d[4];
+        M[2][j] = d[5];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// recursive Gaussian filter (I.T. Young, L.J. van Vliet, "Recursive
+// implementation of the Gaussian filter", 1995): a causal and an anti-causal
+// 3rd order pass per row and per column, independent of sigma;
+// intended for sigma >= 0.5, borders are replicated
+///////////////////////////////////////////////////////////////////////////////
+void Filter::gaussianBlurIIR(const cv::Mat &input, cv::Mat &output, double sigma, int outputType)
+{
+    if (!isOutputType(outputType))
+    {
+        std::cout << "Output type is not supported (use CV_32F or CV_16S)!" << std::endl;
+        return;
+    }
+
+    gaussianBlurIIRTo(input, output, sigma, outputType);
+}
+
+void Filter::gaussianBlurIIR(const cv::Mat &input, HalfImage &output, double sigma)
+{
+    gaussianBlurIIRTo(input, output, sigma, CV_16U);
+}
+
+template <typename Output>
+void Filter::gaussianBlurIIRTo(const cv::Mat &input, Output &output, double sigma, int outputType)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (input.rows < 3 || input.cols < 3)
+    {
+        std::cout << "Image is too small for the recursive filter!" << std::endl;
+        return;
+    }
+
+    // calculate the filter coefficients
+    double q;
+    if (sigma >= 2.5)
+        q = 0.98711 * sigma - 0.96330;
+    else if (sigma >= 0.5)
+        q = 3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * sigma);
+    else
+        q = 3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * 0.5);
+
+    double q2 = q * q;
+    double q3 = q2 * q;
+
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double b1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+    double b2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+    double b3 = (0.422205 * q3) / b0;
+    double bB = 1.0 - (b1 + b2 + b3);
+
+    double M[3][3];
+    iirBorderMatrix(bB, b1, b2, b3, sigma, M);
+
+    float a1 = float(b1), a2 = float(b2), a3 = float(b3), B = float(bB);
+
+    // the recursion runs in place in float; 16 bit outputs are converted at the end
+    cv::Mat result;
+    if (outputType == CV_32F)
+    {
+        input.convertTo(storage(output), CV_32F);
+        result = storage(output);
+    }
+    else
+    {
+        result = temporary(input.rows, input.cols, CV_32F);
+        input.convertTo(result, CV_32F);
+    }
+
+    int rows = result.rows;
+    int cols = result.cols;
+
+    // horizontal: forward and backward pass on every row (in place)
+    for (int r = 0; r < rows; ++r)
+    {
+        float *p = result.ptr<float>(r);
+        float last = p[cols - 1];
+
+        // the border value continues to infinity -> steady state
+        float w1 = p[0], w2 = p[0], w3 = p[0];
+        for (int c = 0; c < cols; ++c)
+        {
+            float w = B * p[c] + a1 * w1 + a2 * w2 + a3 * w3;
+            p[c] = w;
+            w3 = w2;
+            w2 = w1;
+            w1 = w;
+        }
+
+        float s0 = p[cols - 1] - last, s1 = p[cols - 2] - last, s2 = p[cols - 3] - last;
+        float y1 = last + float(M[0][0] * s0 + M[0][1] * s1 + M[0][2] * s2);
+        float y2 = last + float(M[1][0] * s0 + M[1][1] * s1 + M[1][2] * s2);
+        float y3 = last + float(M[2][0] * s0 + M[2][1] * s1 + M[2][2] * s2);
+        for (int c = cols - 1; c >= 0; --c)
+        {
+            float y = B * p[c] + a1 * y1 + a2 * y2 + a3 * y3;
+            p[c] = y;
+            y3 = y2;
+            y2 = y1;
+            y1 = y;
+        }
+    }
+
+    // vertical: the same recursion, but running over whole rows, so that
+    // the inner loop walks through memory linearly
+    std::vector<float> first(result.ptr<float>(0), result.ptr<float>(0) + cols);
+    std::vector<float> last(result.ptr<float>(rows - 1), result.ptr<float>(rows - 1) + cols);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        float *p = result.ptr<float>(r);
+        const float *p1 = r > 0 ? result.ptr<float>(r - 1) : &first[0];
+        const float *p2 = r > 1 ? result.ptr<float>(r - 2) : &first[0];
+        const float *p3 = r > 2 ? result.ptr<float>(r - 3) : &first[0];
+
+        for (int c = 0; c < cols; ++c)
+            p[c] = B * p[c] + a1 * p1[c] + a2 * p2[c] + a3 * p3[c];
+    }
+
+    std::vector<float> border1(cols), border2(cols), border3(cols);
+    const float *pLast0 = result.ptr<float>(rows - 1);
+    const float *pLast1 = result.ptr<float>(rows - 2);
+    const float *pLast2 = result.ptr<float>(rows - 3);
+    for (int c = 0; c < cols; ++c)
+    {
+        float s0 = pLast0[c] - last[c], s1 = pLast1[c] - last[c], s2 = pLast2[c] - last[c];
+        border1[c] = last[c] + float(M[0][0] * s0 + M[0][1] * s1 + M[0][2] * s2);
+        border2[c] = last[c] + float(M[1][0] * s0 + M[1][1] * s1 + M[1][2] * s2);
+        border3[c] = last[c] + float(M[2][0] * s0 + M[2][1] * s1 + M[2][2] * s2);
+    }
+
+    for (int r = rows - 1; r >= 0; --r)
+    {
+        float *p = result.ptr<float>(r);
+        const float *p1 = r < rows - 1 ? result.ptr<float>(r + 1) : &border1[0];
+        const float *p2 = r < rows - 2 ? result.ptr<float>(r + 2) : (r == rows - 2 ? &border1[0] : &border2[0]);
+        const float *p3 = r < rows - 3 ? result.ptr<float>(r + 3)
+                        : (r == rows - 3 ? &border1[0] : (r == rows - 2 ? &border2[0] : &border3[0]));
+
+        for (int c = 0; c < cols; ++c)
+            p[c] = B * p[c] + a1 * p1[c] + a2 * p2[c] + a3 * p3[c];
+    }
+
+    if (outputType != CV_32F)
+    {
+        storage(output).create(rows, cols, outputType);
+        for (int r = 0; r < rows; ++r)
+            storeRow(result.ptr<float>(r), output, r);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Canny edge detector: 3x3 Sobel gradient, non-maximum suppression and
+// hysteresis tracking; the output is a binary image with 1 pixel wide edges.
+// All stages run in parallel (row bands, resp. image tiles)
+///////////////////////////////////////////////////////////////////////////////
+
+// pixel states during hysteresis tracking
+static const uchar CANNY_NONE = 0;
+static const uchar CANNY_WEAK = 1;
+static const uchar CANNY_EDGE = 2;
+
+// neighbours along the quantized gradient direction (see quantizeDirection)
+static const int cannyOffsetX[4] = { 1, 1, 0, -1 };
+static const int cannyOffsetY[4] = { 0, 1, 1,  1 };
+
+// follow weak pixels from the edge pixels inside one tile; edge pixels in the
+// ring around the tile act as seeds, but only pixels inside the tile are
+// written. Returns true if a pixel on the tile's border became an edge pixel
+static bool cannyTrackTile(cv::Mat &state, int r0, int r1, int c0, int c1, std::vector<cv::Point> &stack)
+{
+    int rows = state.rows;
+    int cols = state.cols;
+    bool borderChanged = false;
+
+    stack.clear();
+    for (int r = std::max(r0 - 1, 0); r < std::min(r1 + 1, rows); ++r)
+    {
+        const uchar *pState = state.ptr<uchar>(r);
+        for (int c = std::max(c0 - 1, 0); c < std::min(c1 + 1, cols); ++c)
+        {
+            if (pState[c] == CANNY_EDGE)
+                stack.push_back(cv::Point(c, r));
+        }
+    }
+
+    while (!stack.empty())
+    {
+        cv::Point p = stack.back();
+        stack.pop_back();
+
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            int y = p.y + dy;
+            if (y < r0 || y >= r1)
+                continue;
+
+            uchar *pState = state.ptr<uchar>(y);
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                int x = p.x + dx;
+                if (x < c0 || x >= c1 || pState[x] != CANNY_WEAK)
+                    continue;
+
+                pState[x] = CANNY_EDGE;
+                stack.push_back(cv::Point(x, y));
+
+                if (y == r0 || y == r1 - 1 || x == c0 || x == c1 - 1)
+                    borderChanged = true;
+            }
+        }
+    }
+
+    return borderChanged;
+}
+
+void Filter::canny(const cv::Mat &input, cv::Mat &output, float lowThreshold, float highThreshold)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    int rows = input.rows;
+    int cols = input.cols;
+
+    // (1) gradient magnitude and direction
+    cv::Mat magnitude = temporary(rows, cols, CV_32F);
+    cv::Mat direction = temporary(rows, cols, CV_8U);
+    gradient(input, magnitude, direction, GradientMagnitude::L2);
+
+    // (2) non-maximum suppression and double threshold
+    cv::Mat state = temporary(rows, cols, CV_8U);
+    state.setTo(cv::Scalar(CANNY_NONE));
+
+    parallel_for(1, rows - 1, [&](int rowBegin, int rowEnd)
+    {
+        for (int r = rowBegin; r < rowEnd; ++r)
+        {
+            const float *pMagnitude = magnitude.ptr<float>(r);
+            const uchar *pDirection = direction.ptr<uchar>(r);
+            uchar *pState = state.ptr<uchar>(r);
+
+            for (int c = 1; c < cols - 1; ++c)
+            {
+                float m = pMagnitude[c];
+                if (m <= lowThreshold)
+                    continue;
+
+                int d = pDirection[c];
+                float before = magnitude.ptr<float>(r - cannyOffsetY[d])[c - cannyOffsetX[d]];
+                float after = magnitude.ptr<float>(r + cannyOffsetY[d])[c + cannyOffsetX[d]];
+
+                if (m > before && m >= after)
+                    pState[c] = m > highThreshold ? CANNY_EDGE : CANNY_WEAK;
+            }
+        }
+    }, 32);
+
+    // (3) hysteresis: follow weak pixels inside image tiles in parallel. Tiles
+    // of the same colour (tileX % 2, tileY % 2) never touch each other, so
+    // they can be processed at the same time; a tile whose border changed
+    // makes its neighbours dirty, until nothing changes anymore
+    const int tileSize = 64;
+    int tilesX = (cols + tileSize - 1) / tileSize;
+    int tilesY = (rows + tileSize - 1) / tileSize;
+
+    std::vector<uchar> dirty(tilesX * tilesY, 1);
+    std::vector<uchar> borderChanged(tilesX * tilesY, 0);
+
+    bool anyDirty = true;
+    while (anyDirty)
+    {
+        for (int colour = 0; colour < 4; ++colour)
+        {
+            std::vector<int> tiles;
+            for (int ty = colour / 2; ty < tilesY; ty += 2)
+            {
+                for (int tx = colour % 2; tx < tilesX; tx += 2)
+                {
+                    if (dirty[ty * tilesX + tx])
+                        tiles.push_back(ty * tilesX + tx);
+                }
+            }
+
+            parallel_for(0, int(tiles.size()), [&](int begin, int end)
+            {
+                std::vector<cv::Point> stack;
+                for (int i = begin; i < end; ++i)
+                {
+                    int tile = tiles[i];
+                    int r0 = (tile / tilesX) * tileSize;
+                    int c0 = (tile % tilesX) * tileSize;
+
+                    borderChanged[tile] = cannyTrackTile(state, r0, std::min(r0 + tileSize, rows),
+                                                         c0, std::min(c0 + tileSize, cols), stack);
+                    dirty[tile] = 0;
+                }
+            });
+
+            for (size_t i = 0; i < tiles.size(); ++i)
+            {
+                int tile = tiles[i];
+                if (!borderChanged[tile])
+                    continue;
+
+                int tx = tile % tilesX;
+                int ty = tile / tilesX;
+                for (int ny = std::max(ty - 1, 0); ny <= std::min(ty + 1, tilesY - 1); ++ny)
+                {
+                    for (int nx = std::max(tx - 1, 0); nx <= std::min(tx + 1, tilesX - 1); ++nx)
+                    {
+                        if (ny != ty || nx != tx)
+                            dirty[ny * tilesX + nx] = 1;
+                    }
+                }
+            }
+        }
+
+        anyDirty = std::find(dirty.begin(), dirty.end(), 1) != dirty.end();
+    }
+
+    // (4) binary output image
+    output.create(rows, cols, CV_8U);
+
+    parallel_for(0, rows, [&](int rowBegin, int rowEnd)
+    {
+        for (int r = rowBegin; r < rowEnd; ++r)
+        {
+            const uchar *pState = state.ptr<uchar>(r);
+            uchar *pOutput = output.ptr<uchar>(r);
+
+            for (int c = 0; c < cols; ++c)
+                pOutput[c] = pState[c] == CANNY_EDGE ? 255 : 0;
+        }
+    }, 64);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// blur with the separated 5x5 Binomial kernel and decimate by 2 in one pass:
+// only the rows and columns that are kept get computed
+///////////////////////////////////////////////////////////////////////////////
+
+// the separated 5x5 Binomial kernel sums up to 16 * 16 = 256
+static inline int binomialNormalize(int sum)
+{
+    return (sum + 128) >> 8;
+}
+
+static inline float binomialNormalize(float sum)
+{
+    return sum * (1.0f / 256.0f);
+}
+
+// T: pixel type, A: accumulator type
+template <typename T, typename A>
+static void binomialDecimate(const cv::Mat &input, cv::Mat &output, const signed char *weights)
+{
+    int rows = input.rows;
+    int cols = input.cols;
+    int outRows = output.rows;
+    int outCols = output.cols;
+
+    // vertical sums of one output row, padded by 2 replicated columns per side
+    std::vector<A> buffer(cols + 4);
+    A *pBuffer = &buffer[2];
+
+    for (int y = 0; y < outRows; ++y)
+    {
+        const T *pRows[5];
+        for (int k = 0; k < 5; ++k)
+            pRows[k] = input.ptr<T>(std::min(std::max(2 * y + k - 2, 0), rows - 1));
+
+        for (int c = 0; c < cols; ++c)
+        {
+            pBuffer[c] = A(weights[0]) * pRows[0][c] + A(weights[1]) * pRows[1][c] + A(weights[2]) * pRows[2][c]
+                       + A(weights[3]) * pRows[3][c] + A(weights[4]) * pRows[4][c];
+        }
+
+        pBuffer[-2] = pBuffer[-1] = pBuffer[0];
+        pBuffer[cols] = pBuffer[cols + 1] = pBuffer[cols - 1];
+
+        T *pOutput = output.ptr<T>(y);
+        for (int x = 0; x < outCols; ++x)
+        {
+            const A *p = pBuffer + 2 * x;
+            A sum = A(weights[0]) * p[-2] + A(weights[1]) * p[-1] + A(weights[2]) * p[0]
+                  + A(weights[3]) * p[1] + A(weights[4]) * p[2];
+
+            pOutput[x] = T(binomialNormalize(sum));
+        }
+    }
+}
+
+void Filter::pyrDown(const cv::Mat &input, cv::Mat &output)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (input.type() != CV_8U && input.type() != CV_32F)
+    {
+        std::cout << "Input type is not supported (use CV_8U or CV_32F)!" << std::endl;
+        return;
+    }
+
+    // create() keeps the buffer if size and type did not change
+    output.create((input.rows + 1) / 2, (input.cols + 1) / 2, input.type());
+
+    const signed char *weights = getBinomialSeparated(5, false).ptr<signed char>(0);
+
+    if (input.type() == CV_8U)
+        binomialDecimate<uchar, int>(input, output, weights);
+    else
+        binomialDecimate<float, float>(input, output, weights);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Gaussian pyramid: levels[0] is the input, every further level has half the
+// width and height. Level buffers of a previous call are reused
+///////////////////////////////////////////////////////////////////////////////
+void Filter::buildPyramid(const cv::Mat &input, std::vector<cv::Mat> &levels, int nLevels)
+{
+    if (input.empty() || nLevels < 1)
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    levels.resize(nLevels);
+    levels[0] = input;
+
+    for (int i = 1; i < nLevels; ++i)
+        pyrDown(levels[i - 1], levels[i]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// edge preserving bilateral filter for CV_8U images. The range weights come
+// from a 256 entry table indexed by the absolute grey value difference, the
+// spatial weights from a table of the offsets inside the circular window.
+// Every row keeps one accumulator per column; for every offset a scalar pass
+// looks up the range weights of the row, then the weighted values are
+// accumulated 4 pixels at a time (SSE2/NEON). The rows are filtered in
+// parallel. Borders are replicated
+///////////////////////////////////////////////////////////////////////////////
+void Filter::bilateral(const cv::Mat &input, cv::Mat &output, int diameter, double sigmaColor, double sigmaSpace)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (input.type() != CV_8U)
+    {
+        std::cout << "Input type is not supported (use CV_8U)!" << std::endl;
+        return;
+    }
+
+    if (sigmaColor <= 0.0 || sigmaSpace <= 0.0)
+    {
+        std::cout << "Sigma must be positive!" << std::endl;
+        return;
+    }
+
+    // same default as OpenCV: the window covers +-1.5 sigma
+    int radius = diameter > 0 ? diameter / 2 : cvRound(sigmaSpace * 1.5);
+    radius = std::max(radius, 1);
+
+    float rangeWeight[256];
+    double colorCoeff = -0.5 / (sigmaColor * sigmaColor);
+    for (int d = 0; d < 256; ++d)
+        rangeWeight[d] = float(std::exp(d * d * colorCoeff));
+
+    std::vector<int> offsetX, offsetY;
+    std::vector<float> spaceWeight;
+    double spaceCoeff = -0.5 / (sigmaSpace * sigmaSpace);
+
+    for (int dy = -radius; dy <= radius; ++dy)
+    {
+        for (int dx = -radius; dx <= radius; ++dx)
+        {
+            int distance2 = dx * dx + dy * dy;
+            if (distance2 > radius * radius)
+                continue;
+
+            offsetX.push_back(dx);
+            offsetY.push_back(dy);
+            spaceWeight.push_back(float(std::exp(distance2 * spaceCoeff)));
+        }
+    }
+
+    cv::Mat padded = temporary(input.rows + 2 * radius, input.cols + 2 * radius, CV_8U);
+    cv::copyMakeBorder(input, padded, radius, radius, radius, radius, cv::BORDER_REPLICATE);
+
+    int cols = input.cols;
+    int nOffsets = int(spaceWeight.size());
+
+    Workspace::prepareOutput(input, output, input.rows, input.cols, CV_8U);
+
+    // one row of accumulators per image row, so the threads share nothing
+    cv::Mat sums = temporary(input.rows, cols, CV_32F);
+    cv::Mat weightSums = temporary(input.rows, cols, CV_32F);
+    cv::Mat rangeWeights = temporary(input.rows, cols, CV_32F);
+
+    parallel_for(0, input.rows, [&](int rowBegin, int rowEnd)
+    {
+        for (int r = rowBegin; r < rowEnd; ++r)
+        {
+            const uchar *pCenter = padded.ptr<uchar>(r + radius) + radius;
+            float *sum = sums.ptr<float>(r);
+            float *weightSum = weightSums.ptr<float>(r);
+            float *range = rangeWeights.ptr<float>(r);
+            std::fill(sum, sum + cols, 0.0f);
+            std::fill(weightSum, weightSum + cols, 0.0f);
+
+            for (int k = 0; k < nOffsets; ++k)
+            {
+                const uchar *pNeighbour = padded.ptr<uchar>(r + radius + offsetY[k]) + radius + offsetX[k];
+                const float weight = spaceWeight[k];
+
+                for (int c = 0; c < cols; ++c)
+                    range[c] = rangeWeight[std::abs(int(pNeighbour[c]) - int(pCenter[c]))];
+
+                int c = 0;
+
+#if defined(__SSE2__)
+                const __m128i zero = _mm_setzero_si128();
+                const __m128 spatial = _mm_set1_ps(weight);
+
+                for (; c + 4 <= cols; c += 4)
+                {
+                    int32_t neighbour4;
+                    memcpy(&neighbour4, pNeighbour + c, 4);
+
+                    __m128 value = _mm_cvtepi32_ps(_mm_unpacklo_epi16(
+                        _mm_unpacklo_epi8(_mm_cvtsi32_si128(neighbour4), zero), zero));
+                    __m128 w = _mm_mul_ps(spatial, _mm_loadu_ps(range + c));
+
+                    _mm_storeu_ps(&sum[c], _mm_add_ps(_mm_loadu_ps(&sum[c]), _mm_mul_ps(w, value)));
+                    _mm_storeu_ps(&weightSum[c], _mm_add_ps(_mm_loadu_ps(&weightSum[c]), w));
+                }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+                for (; c + 4 <= cols; c += 4)
+                {
+                    uint8x8_t neighbour8 = vreinterpret_u8_u32(vld1_lane_u32((const uint32_t *)(pNeighbour + c),
+                                                                             vdup_n_u32(0), 0));
+
+                    float32x4_t value = vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(neighbour8))));
+                    float32x4_t w = vmulq_n_f32(vld1q_f32(range + c), weight);
+
+                    vst1q_f32(&sum[c], vaddq_f32(vld1q_f32(&sum[c]), vmulq_f32(w, value)));
+                    vst1q_f32(&weightSum[c], vaddq_f32(vld1q_f32(&weightSum[c]), w));
+                }
+#endif
+
+                for (; c < cols; ++c)
+                {
+                    float value = pNeighbour[c];
+                    float w = weight * range[c];
+                    sum[c] += w * value;
+                    weightSum[c] += w;
+                }
+            }
+
+            // the centre tap has weight 1, so weightSum is never zero
+            uchar *pOutput = output.ptr<uchar>(r);
+            for (int c = 0; c < cols; ++c)
+                pOutput[c] = cv::saturate_cast<uchar>(sum[c] / weightSum[c]);
+        }
+    }, 4);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// convolve the image with several kernels of the same size in one pass
+// (same cropped edges and normalisation as convolve_generic). For every tap
+// the input values are loaded once and multiplied into all kernels with a
+// non-zero weight there; the outputs are processed in column blocks, so the
+// input row segment and the output accumulators stay in the cache
+///////////////////////////////////////////////////////////////////////////////
+void Filter::convolveBank(const cv::Mat &input, const std::vector<cv::Mat> &kernels, std::vector<cv::Mat> &outputs)
+{
+    if (input.empty() || kernels.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    int kRows = kernels[0].rows;
+    int kCols = kernels[0].cols;
+    int nKernels = int(kernels.size());
+
+    for (int k = 0; k < nKernels; ++k)
+    {
+        if (kernels[k].type() != CV_8S && kernels[k].type() != CV_32F)
+        {
+            std::cout << "Kernel type is not supported (use CV_8S or CV_32F)!" << std::endl;
+            return;
+        }
+
+        if (kernels[k].rows != kRows || kernels[k].cols != kCols)
+        {
+            std::cout << "All kernels of a bank must have the same size!" << std::endl;
+            return;
+        }
+
+        // CV_8S kernels are normalized by the sum of their absolute taps
+        if (kernels[k].type() == CV_8S && kernelNormFactor(kernels[k]) == 0.0f)
+        {
+            std::cout << "CV_8S kernel is all zero and can not be normalized!" << std::endl;
+            return;
+        }
+    }
+
+    cv::Mat floatInput;
+    if (input.type() == CV_32F)
+        floatInput = input;
+    else
+    {
+        floatInput = temporary(input.rows, input.cols, CV_32F);
+        input.convertTo(floatInput, CV_32F);
+    }
+
+    // per tap: the kernels with a non-zero (normalized) weight
+    struct BankTap
+    {
+        int kernel;
+        float weight;
+    };
+    std::vector<std::vector<BankTap> > taps(kRows * kCols);
+
+    for (int k = 0; k < nKernels; ++k)
+    {
+        float normFactor = kernelNormFactor(kernels[k]);
+
+        for (int kr = 0; kr < kRows; ++kr)
+        {
+            for (int kc = 0; kc < kCols; ++kc)
+            {
+                float weight = kernels[k].type() == CV_8S ? kernels[k].at<signed char>(kr, kc) / normFactor
+                                                          : kernels[k].at<float>(kr, kc);
+                if (weight != 0.0f)
+                {
+                    BankTap tap = { k, weight };
+                    taps[kr * kCols + kc].push_back(tap);
+                }
+            }
+        }
+    }
+
+    int rows = floatInput.rows;
+    int cols = floatInput.cols;
+    int kHotspotX = kCols / 2;
+    int kHotspotY = kRows / 2;
+
+    outputs.resize(nKernels);
+    for (int k = 0; k < nKernels; ++k)
+    {
+        Workspace::prepareOutput(input, outputs[k], rows, cols, CV_32F);
+        Workspace::clearBorder(outputs[k], kHotspotY, kRows - 1 - kHotspotY, kHotspotX, kCols - 1 - kHotspotX);
+    }
+
+    int outRows = rows - kRows + 1;
+    int outCols = cols - kCols + 1;
+    if (outRows <= 0 || outCols <= 0)
+        return;
+
+    const int blockSize = 256;
+
+    parallel_for(0, outRows, [&](int rowBegin, int rowEnd)
+    {
+        std::vector<float *> pOutputs(nKernels);
+
+        for (int r = rowBegin; r < rowEnd; ++r)
+        {
+            for (int c0 = 0; c0 < outCols; c0 += blockSize)
+            {
+                int width = std::min(blockSize, outCols - c0);
+
+                for (int k = 0; k < nKernels; ++k)
+                {
+                    pOutputs[k] = outputs[k].ptr<float>(r + kHotspotY) + kHotspotX + c0;
+                    std::fill(pOutputs[k], pOutputs[k] + width, 0.0f);
+                }
+
+                for (int kr = 0; kr < kRows; ++kr)
+                {
+                    const float *pInputRow = floatInput.ptr<float>(r + kr) + c0;
+
+                    for (int kc = 0; kc < kCols; ++kc)
+                    {
+                        const std::vector<BankTap> &tapKernels = taps[kr * kCols + kc];
+                        const float *pInput = pInputRow + kc;
+
+                        for (size_t t = 0; t < tapKernels.size(); ++t)
+                        {
+                            float *pOutput = pOutputs[tapKernels[t].kernel];
+                            float weight = tapKernels[t].weight;
+
+                            for (int c = 0; c < width; ++c)
+                                pOutput[c] += pInput[c] * weight;
+                        }
+                    }
+                }
+            }
+        }
+    }, 8);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Winograd F(2x2, 3x3) convolution
+//
+// every 2x2 output tile is computed from a 4x4 input tile d as
+//     Y = A^T [(G g G^T) .* (B^T d B)] A
+// with 16 instead of 36 multiplications. The kernel transform G g G^T is
+// cached per kernel; the input and output transforms only need additions
+///////////////////////////////////////////////////////////////////////////////
+void Filter::setConvolution3x3Engine(Convolution3x3Engine engine)
+{
+    convolution3x3Engine = engine;
+}
+
+const Filter::WinogradKernel &Filter::getWinogradKernel(const cv::Mat &kernel)
+{
+    size_t rowBytes = 3 * kernel.elemSize();
+
+    for (size_t i = 0; i < winogradCache.size(); ++i)
+    {
+        const cv::Mat &cached = winogradCache[i].kernel;
+
+        if (cached.type() != kernel.type())
+            continue;
+
+        bool equal = true;
+        for (int r = 0; r < 3 && equal; ++r)
+            equal = memcmp(cached.ptr(r), kernel.ptr(r), rowBytes) == 0;
+
+        if (equal)
+            return winogradCache[i];
+    }
+
+    float normFactor = kernelNormFactor(kernel);
+
+    float g[3][3];
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            g[r][c] = (kernel.type() == CV_8S ? kernel.at<signed char>(r, c) : kernel.at<float>(r, c)) / normFactor;
+
+    // G = [1 0 0; 1/2 1/2 1/2; 1/2 -1/2 1/2; 0 0 1]
+    const float G[4][3] = { { 1.0f, 0.0f, 0.0f }, { 0.5f, 0.5f, 0.5f }, { 0.5f, -0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f } };
+
+    float Gg[4][3];
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 3; ++j)
+            Gg[i][j] = G[i][0] * g[0][j] + G[i][1] * g[1][j] + G[i][2] * g[2][j];
+
+    WinogradKernel entry;
+    entry.kernel = kernel.clone();
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            entry.transform[i * 4 + j] = Gg[i][0] * G[j][0] + Gg[i][1] * G[j][1] + Gg[i][2] * G[j][2];
+
+    if (winogradCache.size() >= 32)
+        winogradCache.erase(winogradCache.begin());
+
+    winogradCache.push_back(entry);
+    return winogradCache.back();
+}
+
+// transform a batch of n tiles whose upper left input pixels are at x[t] in
+// the four rows pRows; the 16 values of a tile are stored with a stride of
+// WINOGRAD_BATCH, so every step is a plain loop over the batch (vectorized)
+#define WINOGRAD_BATCH 64
+
+static void winogradTiles(const float *pRows[4], float *pOutputRows[2], const int *x, int n, const float *U)
+{
+    float d[16][WINOGRAD_BATCH];
+    float m[16][WINOGRAD_BATCH];
+
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            for (int t = 0; t < n; ++t)
+                d[i * 4 + j][t] = pRows[i][x[t] + j];
+
+    // B^T d: combine the rows
+    for (int j = 0; j < 4; ++j)
+    {
+        for (int t = 0; t < n; ++t)
+        {
+            float d0 = d[j][t], d1 = d[4 + j][t], d2 = d[8 + j][t], d3 = d[12 + j][t];
+            m[j][t] = d0 - d2;
+            m[4 + j][t] = d1 + d2;
+            m[8 + j][t] = d2 - d1;
+            m[12 + j][t] = d1 - d3;
+        }
+    }
+
+    // (B^T d) B: combine the columns, then multiply with the kernel transform
+    for (int i = 0; i < 4; ++i)
+    {
+        const float u0 = U[i * 4], u1 = U[i * 4 + 1], u2 = U[i * 4 + 2], u3 = U[i * 4 + 3];
+        float *m0 = m[i * 4], *m1 = m[i * 4 + 1], *m2 = m[i * 4 + 2], *m3 = m[i * 4 + 3];
+
+        for (int t = 0; t < n; ++t)
+        {
+            float t0 = m0[t], t1 = m1[t], t2 = m2[t], t3 = m3[t];
+            m0[t] = (t0 - t2) * u0;
+            m1[t] = (t1 + t2) * u1;
+            m2[t] = (t2 - t1) * u2;
+            m3[t] = (t1 - t3) * u3;
+        }
+    }
+
+    // A^T M A with A^T = [1 1 1 0; 0 1 -1 -1]
+    for (int t = 0; t < n; ++t)
+    {
+        float r0[4], r1[4];
+        for (int j = 0; j < 4; ++j)
+        {
+            r0[j] = m[j][t] + m[4 + j][t] + m[8 + j][t];
+            r1[j] = m[4 + j][t] - m[8 + j][t] - m[12 + j][t];
+        }
+
+        float *pOutput0 = pOutputRows[0] + x[t];
+        float *pOutput1 = pOutputRows[1] + x[t];
+        pOutput0[0] = r0[0] + r0[1] + r0[2];
+        pOutput0[1] = r0[1] - r0[2] - r0[3];
+        pOutput1[0] = r1[0] + r1[1] + r1[2];
+        pOutput1[1] = r1[1] - r1[2] - r1[3];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// 3x3 convolution with the Winograd algorithm; same cropped edges and
+// normalisation as convolve_3x3 (CV_32F kernels are applied as they are)
+///////////////////////////////////////////////////////////////////////////////
+void Filter::convolve_winograd(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    if (input.empty() || kernel.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (kernel.rows != 3 || kernel.cols != 3 || (kernel.type() != CV_8S && kernel.type() != CV_32F))
+    {
+        std::cout << "Winograd convolution needs a 3x3 CV_8S or CV_32F kernel!" << std::endl;
+        return;
+    }
+
+    cv::Mat floatInput;
+    if (input.type() == CV_32F)
+        floatInput = input;
+    else
+    {
+        floatInput = temporary(input.rows, input.cols, CV_32F);
+        input.convertTo(floatInput, CV_32F);
+    }
+
+    int rows = floatInput.rows;
+    int cols = floatInput.cols;
+
+    Workspace::prepareOutput(input, output, rows, cols, CV_32F);
+    Workspace::clearBorder(output, 1, 1, 1, 1);
+
+    // (rows - 2) x (cols - 2) output pixels; too small for a single tile?
+    int outRows = rows - 2;
+    int outCols = cols - 2;
+
+    if (outRows < 2 || outCols < 2)
+    {
+        if (outRows > 0 && outCols > 0)
+        {
+            if (kernel.type() == CV_8S)
+                convolveDirect<signed char>(floatInput, output, kernel, kernelNormFactor(kernel));
+            else
+                convolveDirect<float>(floatInput, output, kernel, 1.0f);
+        }
+        return;
+    }
+
+    const float *U = getWinogradKernel(kernel).transform;
+
+    // tile origins; an odd size is covered by a last, overlapping tile
+    std::vector<int> tileX, tileY;
+    for (int x = 0; x + 2 <= outCols; x += 2)
+        tileX.push_back(x);
+    if (outCols % 2)
+        tileX.push_back(outCols - 2);
+
+    for (int y = 0; y + 2 <= outRows; y += 2)
+        tileY.push_back(y);
+    if (outRows % 2)
+        tileY.push_back(outRows - 2);
+
+    int nTilesX = int(tileX.size());
+
+    auto tileRow = [&](int y)
+    {
+        const float *pRows[4] = { floatInput.ptr<float>(y), floatInput.ptr<float>(y + 1),
+                                  floatInput.ptr<float>(y + 2), floatInput.ptr<float>(y + 3) };
+        float *pOutputRows[2] = { output.ptr<float>(y + 1) + 1, output.ptr<float>(y + 2) + 1 };
+
+        for (int t = 0; t < nTilesX; t += WINOGRAD_BATCH)
+            winogradTiles(pRows, pOutputRows, &tileX[t], std::min(WINOGRAD_BATCH, nTilesX - t), U);
+    };
+
+    // the overlapping last tile row runs after the others, so that no two
+    // threads write the same pixels
+    int nRegular = outRows / 2;
+
+    parallel_for(0, nRegular, [&](int tileBegin, int tileEnd)
+    {
+        for (int i = tileBegin; i < tileEnd; ++i)
+            tileRow(tileY[i]);
+    }, 4);
+
+    if (outRows % 2)
+        tileRow(tileY[nRegular]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// largest absolute difference between the Winograd convolution and
+// convolve_cv on the inner pixels (where the border handling does not matter)
+///////////////////////////////////////////////////////////////////////////////
+double Filter::winogradAccuracy(const cv::Mat &input, const cv::Mat &kernel)
+{
+    if (input.rows < 3 || input.cols < 3 || kernel.type() != CV_8S)
+    {
+        std::cout << "Accuracy check needs an image of at least 3x3 and a CV_8S kernel!" << std::endl;
+        return -1.0;
+    }
+
+    cv::Mat reference, winograd;
+    convolve_cv(input, reference, kernel);
+    convolve_winograd(input, winograd, kernel);
+
+    double maxError = 0.0;
+    for (int r = 1; r < input.rows - 1; ++r)
+    {
+        const float *pReference = reference.ptr<float>(r);
+        const float *pWinograd = winograd.ptr<float>(r);
+
+        for (int c = 1; c < input.cols - 1; ++c)
+            maxError = std::max(maxError, double(fabs(pReference[c] - pWinograd[c])));
+    }
+
+    return maxError;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// binary edge map of a CV_8U image: Gaussian blur (FIR, replicated borders),
+// 3x3 Sobel gradient, magnitude and threshold (>= threshold -> 255) fused
+// into one pass. Only a ring of horizontally blurred rows (kernel size) and
+// a ring of three fully blurred rows are kept per thread, no full frame
+// intermediates. The result equals the FIR gaussianBlur + gradient +
+// threshold (for any sigma); the one pixel wide border is 0
+///////////////////////////////////////////////////////////////////////////////
+void Filter::edgeMap(const cv::Mat &input, cv::Mat &output, double sigma, float threshold, GradientMagnitude kind)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (input.type() != CV_8U)
+    {
+        std::cout << "Input type is not supported (use CV_8U)!" << std::endl;
+        return;
+    }
+
+    int rows = input.rows;
+    int cols = input.cols;
+
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+    Workspace::clearBorder(output, 1, 1, 1, 1);
+
+    if (rows < 3 || cols < 3)
+        return;
+
+    int size = 2 * int(ceil(3.0 * sigma)) + 1;
+    if (sigma != gaussianSigma || gaussianKernelHorizontal.empty())
+    {
+        setGaussianKernels1D(gaussianKernelHorizontal, gaussianKernelVertical, size, sigma);
+        gaussianSigma = sigma;
+    }
+
+    const float *pKernel = gaussianKernelHorizontal.ptr<float>(0);
+    int half = size / 2;
+
+    parallel_for(1, rows - 1, [&](int rowBegin, int rowEnd)
+    {
+        std::vector<float> padded(cols + 2 * half);
+        std::vector<float> horizontalRing(size * cols);
+        std::vector<float> blurredRing(3 * cols);
+        std::vector<float> magnitudeRow(cols);
+
+        // horizontal pass of input row r into the ring slot r % size
+        auto horizontalRow = [&](int r)
+        {
+            const uchar *pInput = input.ptr<uchar>(r);
+            float *pHorizontal = &horizontalRing[(r % size) * cols];
+
+            for (int c = 0; c < half; ++c)
+            {
+                padded[c] = pInput[0];
+                padded[cols + half + c] = pInput[cols - 1];
+            }
+            for (int c = 0; c < cols; ++c)
+                padded[half + c] = pInput[c];
+
+            for (int c = 0; c < cols; ++c)
+            {
+                const float *pPadded = &padded[c];
+                float result = 0.0f;
+
+                for (int k = 0; k < size; ++k)
+                    result += pPadded[k] * pKernel[k];
+
+                pHorizontal[c] = result;
+            }
+        };
+
+        // vertical pass for blurred row r into the ring slot r % 3
+        auto blurredRow = [&](int r)
+        {
+            float *pBlurred = &blurredRing[(r % 3) * cols];
+
+            const float *pFirst = &horizontalRing[(std::max(r - half, 0) % size) * cols];
+            for (int c = 0; c < cols; ++c)
+                pBlurred[c] = pFirst[c] * pKernel[0];
+
+            for (int k = 1; k < size; ++k)
+            {
+                int inputRow = std::min(std::max(r + k - half, 0), rows - 1);
+                const float *pHorizontal = &horizontalRing[(inputRow % size) * cols];
+                float weight = pKernel[k];
+
+                for (int c = 0; c < cols; ++c)
+                    pBlurred[c] += pHorizontal[c] * weight;
+            }
+        };
+
+        // warm up: horizontal rows for the first blurred row (rowBegin - 1)
+        int nextHorizontal = std::max(rowBegin - 1 - half, 0);
+        int lastNeeded = std::min(rowBegin - 1 + half, rows - 1);
+        for (; nextHorizontal <= lastNeeded; ++nextHorizontal)
+            horizontalRow(nextHorizontal);
+
+        blurredRow(rowBegin - 1);
+
+        for (int r = rowBegin - 1; r < rowEnd; ++r)
+        {
+            // blurred row r + 1 needs input rows up to r + 1 + half
+            lastNeeded = std::min(r + 1 + half, rows - 1);
+            for (; nextHorizontal <= lastNeeded; ++nextHorizontal)
+                horizontalRow(nextHorizontal);
+
+            blurredRow(r + 1);
+
+            if (r < rowBegin)
+                continue;
+
+            // Sobel on the blurred rows r - 1, r, r + 1, then threshold
+            sobelRow<float>(&blurredRing[((r - 1) % 3) * cols], &blurredRing[(r % 3) * cols],
+                            &blurredRing[((r + 1) % 3) * cols], &magnitudeRow[0], 0, cols, kind);
+
+            uchar *pOutput = output.ptr<uchar>(r);
+            for (int c = 1; c < cols - 1; ++c)
+                pOutput[c] = magnitudeRow[c] >= threshold ? 255 : 0;
+        }
+    }, 32);
+}
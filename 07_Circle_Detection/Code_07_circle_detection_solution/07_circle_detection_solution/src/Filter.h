@@ -1,8 +1,40 @@
 #ifndef FILTER_H
 #define FILTER_H
 
+#include <algorithm>
+#include <vector>
+#include <string.h>
+
 #include <opencv2/core/core.hpp>
 
+#include "FFT.h"
+#include "Float16.h"
+#include "KernelFactory.h"
+#include "Workspace.h"
+
+// how the gradient magnitude is computed from the x- and y-derivative
+enum class GradientMagnitude
+{
+    L2,              // sqrt(gx^2 + gy^2), using a fast reciprocal square root
+    L1,              // |gx| + |gy|
+    AlphaMaxBetaMin  // alpha * max(|gx|, |gy|) + beta * min(|gx|, |gy|)
+};
+
+// convolution algorithms that convolve_auto can choose from
+enum class ConvolutionMethod
+{
+    Direct,     // kRows * kCols multiplications per pixel
+    Separable,  // kRows + kCols multiplications per pixel (rank 1 kernels)
+    FFT         // independent of the kernel size
+};
+
+// algorithms behind convolve_3x3
+enum class Convolution3x3Engine
+{
+    Direct,    // 9 multiplications per pixel
+    Winograd   // F(2x2, 3x3): 16 multiplications per 2x2 output tile
+};
+
 class Filter
 {
 public:
@@ -10,12 +42,60 @@ public:
 
     ~Filter();
 
+    // temporaries are taken from the workspace if one is set (not owned); they
+    // stay valid until its owner calls beginFrame(), which it has to do once per frame
+    void setWorkspace(Workspace *workspace);
+
     void convolve_cv(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
     void convolve_3x3(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void convolve_winograd(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void setConvolution3x3Engine(Convolution3x3Engine engine);
+    double winogradAccuracy(const cv::Mat &input, const cv::Mat &kernel);
     void convolve_generic(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void convolve_fft(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void convolve_auto(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void convolveBank(const cv::Mat &input, const std::vector<cv::Mat> &kernels, std::vector<cv::Mat> &outputs);
+    ConvolutionMethod selectConvolution(const cv::Mat &input, const cv::Mat &kernel);
     void convolve_extrapolate(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
     void getAbsOfSobel(const cv::Mat &input_1, const cv::Mat &input_2, cv::Mat &output);
     void scaleSobelImage(const cv::Mat &input, cv::Mat &output);
+    // the input may be CV_8U, CV_16U, CV_32F or fixed point CV_16S (see
+    // Float16.h); the magnitude is stored as CV_32F or CV_16S
+    void gradient(const cv::Mat &input, cv::Mat &magnitude,
+                  GradientMagnitude kind = GradientMagnitude::L2, int magnitudeType = CV_32F);
+    void gradient(const cv::Mat &input, cv::Mat &magnitude, cv::Mat &direction,
+                  GradientMagnitude kind = GradientMagnitude::L2, int magnitudeType = CV_32F);
+    // half precision input and magnitude
+    void gradient(const HalfImage &input, HalfImage &magnitude, GradientMagnitude kind = GradientMagnitude::L2);
+    void gradient(const HalfImage &input, HalfImage &magnitude, cv::Mat &direction,
+                  GradientMagnitude kind = GradientMagnitude::L2);
+
+    void canny(const cv::Mat &input, cv::Mat &output, float lowThreshold, float highThreshold);
+
+    // gaussianBlur -> gradient -> threshold in one streaming pass (CV_8U, 0/255)
+    void edgeMap(const cv::Mat &input, cv::Mat &output, double sigma, float threshold,
+                 GradientMagnitude kind = GradientMagnitude::L2);
+
+    void pyrDown(const cv::Mat &input, cv::Mat &output);
+    void buildPyramid(const cv::Mat &input, std::vector<cv::Mat> &levels, int nLevels);
+
+    void bilateral(const cv::Mat &input, cv::Mat &output, int diameter, double sigmaColor, double sigmaSpace);
+
+    void boxFilter(const cv::Mat &input, cv::Mat &output, int size);
+    void gaussianBlurBox(const cv::Mat &input, cv::Mat &output, double sigma, int passes = 3);
+
+    void setGaussianKernels1D(cv::Mat &kernelHorizontal, cv::Mat &kernelVertical, int size, const double sigma);
+    // outputType: CV_32F or fixed point CV_16S (see Float16.h); the HalfImage
+    // overloads store half precision
+    void convolve_separable(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernelHorizontal,
+                            const cv::Mat &kernelVertical, int outputType = CV_32F);
+    void convolve_separable(const cv::Mat &input, HalfImage &output, const cv::Mat &kernelHorizontal,
+                            const cv::Mat &kernelVertical);
+    void gaussianBlur(const cv::Mat &input, cv::Mat &output, double sigma, int outputType = CV_32F);
+    void gaussianBlur(const cv::Mat &input, HalfImage &output, double sigma);
+    void gaussianBlurIIR(const cv::Mat &input, cv::Mat &output, double sigma, int outputType = CV_32F);
+    void gaussianBlurIIR(const cv::Mat &input, HalfImage &output, double sigma);
+    void setGaussianIIRThreshold(double sigma);
     
     cv::Mat calcBinomial(uchar size);
     cv::Mat calcSobel(uchar size, bool transpose);
@@ -25,14 +105,159 @@ public:
     cv::Mat getSobelX(uchar size);
     cv::Mat getSobelY(uchar size);
 
+    // normalized float factors for any odd size (built with the KernelFactory)
+    cv::Mat getBinomial1D(int size, bool transpose);
+    cv::Mat getSobelDerivative1D(int size, bool transpose);
+
+    // separable convolution with compile-time kernels, e.g.
+    // convolve_separable_fixed(input, output, kernels::binomialNormalized<float, 7>(), ...)
+    template <int N>
+    void convolve_separable_fixed(const cv::Mat &input, cv::Mat &output,
+                                  const kernels::Kernel1D<float, N> &kernelHorizontal,
+                                  const kernels::Kernel1D<float, N> &kernelVertical);
+
 private:
+    Workspace *workspace;
+
+    cv::Mat temporary(int rows, int cols, int type);
+
     cv::Mat Binomial3, Binomial5;
     cv::Mat Binomial5x1, Binomial1x5;
     cv::Mat Binomial3x1, Binomial1x3;
     cv::Mat Sobel3_X, Sobel3_Y;
     cv::Mat Sobel5_X, Sobel5_Y;
 
+    // gaussianBlur switches from the FIR to the recursive filter above this sigma
+    double gaussianIIRThreshold;
+
+    // FIR kernels of the last gaussianBlur call
+    double gaussianSigma;
+    cv::Mat gaussianKernelHorizontal, gaussianKernelVertical;
+
     int calcBinomialCoefficient(int n, int k);
+
+    // result of the separability test of a 2D kernel; convolve_generic keeps
+    // the results, so every kernel is analyzed only once
+    struct SeparableKernel
+    {
+        cv::Mat kernel;      // copy of the analyzed kernel
+        bool separable;
+        cv::Mat horizontal;  // 1 x kCols, CV_32F
+        cv::Mat vertical;    // kRows x 1, CV_32F (includes the normalisation)
+    };
+    std::vector<SeparableKernel> separableCache;
+
+    const SeparableKernel &analyzeKernel(const cv::Mat &kernel, float normFactor);
+    void convolve_generic_separable(const cv::Mat &input, cv::Mat &output, const SeparableKernel &separated);
+
+    // frequency domain convolution; the spectrum of the last kernel is kept
+    FFT fft;
+    cv::Mat fftKernel;
+    int fftHeight, fftWidth;
+    std::vector<std::complex<float> > fftKernelSpectrum;
+    std::vector<std::complex<float> > fftSpectrum;   // input spectrum, kept between calls
+    cv::Mat fftCorrelation;
+
+    // Winograd transforms G * g * G^T of the used 3x3 kernels
+    Convolution3x3Engine convolution3x3Engine;
+    struct WinogradKernel
+    {
+        cv::Mat kernel;       // copy of the kernel
+        float transform[16];  // 4x4, includes the normalisation
+    };
+    std::vector<WinogradKernel> winogradCache;
+
+    const WinogradKernel &getWinogradKernel(const cv::Mat &kernel);
+
+    float kernelNormFactor(const cv::Mat &kernel);
+
+    // shared implementations of the cv::Mat and HalfImage overloads
+    template <typename Input, typename Magnitude>
+    void gradient_3x3(const Input &input, Magnitude &magnitude, cv::Mat *direction, GradientMagnitude kind,
+                      int magnitudeType);
+    template <typename Output>
+    void convolveSeparableTo(const cv::Mat &input, Output &output, const cv::Mat &kernelHorizontal,
+                             const cv::Mat &kernelVertical, int outputType);
+    template <typename Output>
+    void gaussianBlurTo(const cv::Mat &input, Output &output, double sigma, int outputType);
+    template <typename Output>
+    void gaussianBlurIIRTo(const cv::Mat &input, Output &output, double sigma, int outputType);
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// convolve the image with a separated kernel whose size is known at compile
+// time (the tap loops get unrolled); borders are replicated
+///////////////////////////////////////////////////////////////////////////////
+template <int N>
+void Filter::convolve_separable_fixed(const cv::Mat &input, cv::Mat &output,
+                                      const kernels::Kernel1D<float, N> &kernelHorizontal,
+                                      const kernels::Kernel1D<float, N> &kernelVertical)
+{
+    if (input.empty())
+        return;
+
+    cv::Mat floatInput;
+    if (input.type() == CV_32F)
+        floatInput = input;
+    else
+    {
+        floatInput = temporary(input.rows, input.cols, CV_32F);
+        input.convertTo(floatInput, CV_32F);
+    }
+
+    const int half = N / 2;
+    int rows = floatInput.rows;
+    int cols = floatInput.cols;
+
+    // horizontal pass on a replicate-padded copy of every row
+    cv::Mat horizontal = temporary(rows, cols, CV_32F);
+    cv::Mat paddedRow = temporary(1, cols + 2 * half, CV_32F);
+    float *padded = paddedRow.ptr<float>(0);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        const float *pInput = floatInput.ptr<float>(r);
+        float *pOutput = horizontal.ptr<float>(r);
+
+        for (int c = 0; c < half; ++c)
+        {
+            padded[c] = pInput[0];
+            padded[cols + half + c] = pInput[cols - 1];
+        }
+        memcpy(&padded[half], pInput, cols * sizeof(float));
+
+        for (int c = 0; c < cols; ++c)
+        {
+            const float *pPadded = &padded[c];
+            float result = 0.0f;
+
+            for (int k = 0; k < N; ++k)
+                result += pPadded[k] * kernelHorizontal[k];
+
+            pOutput[c] = result;
+        }
+    }
+
+    // vertical pass: accumulate whole rows (the first tap initializes the output)
+    output.create(rows, cols, CV_32F);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        float *pOutput = output.ptr<float>(r);
+
+        const float *pFirst = horizontal.ptr<float>(std::max(r - half, 0));
+        for (int c = 0; c < cols; ++c)
+            pOutput[c] = pFirst[c] * kernelVertical[0];
+
+        for (int k = 1; k < N; ++k)
+        {
+            const float *pInput = horizontal.ptr<float>(std::min(std::max(r + k - half, 0), rows - 1));
+            const float weight = kernelVertical[k];
+
+            for (int c = 0; c < cols; ++c)
+                pOutput[c] += pInput[c] * weight;
+        }
+    }
+}
+
 #endif /* FILTER_H */
@@ -0,0 +1,236 @@
+#include <math.h>
+#include <string.h>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "Float16.h"
+
+////////////////////////////////////////////////////////////////////////////////////
+// scalar conversions (IEEE binary16, round to nearest even)
+////////////////////////////////////////////////////////////////////////////////////
+static inline float halfToFloatScalar(uint16_t h)
+{
+    uint32_t sign = uint32_t(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits;
+
+    if (exponent == 0x1f)
+    {
+        // infinity or NaN
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (mantissa != 0)
+    {
+        // subnormal half: normalize the mantissa
+        exponent = 113;
+        while ((mantissa & 0x400) == 0)
+        {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    else
+    {
+        bits = sign;
+    }
+
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static inline uint16_t floatToHalfScalar(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+
+    uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+    uint32_t absBits = bits & 0x7fffffff;
+
+    // NaN stays NaN, infinity and overflow become infinity
+    if (absBits > 0x7f800000)
+        return sign | 0x7e00;
+    if (absBits >= 0x477ff000)
+        return sign | 0x7c00;
+
+    if (absBits < 0x38800000)
+    {
+        // result is subnormal (or zero): shift the mantissa with the hidden
+        // bit into place and round to nearest even
+        if (absBits < 0x33000000)
+            return sign;
+
+        uint32_t exponent = absBits >> 23;
+        uint32_t mantissa = (absBits & 0x7fffff) | 0x800000;
+        uint32_t shift = 126 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint = 1u << (shift - 1);
+
+        if (rest > midpoint || (rest == midpoint && (half & 1)))
+            ++half;
+        return sign | uint16_t(half);
+    }
+
+    // normal: rebias the exponent and round the mantissa to nearest even
+    uint32_t rounded = absBits - 0x38000000 + 0xfff + ((absBits >> 13) & 1);
+    return sign | uint16_t(rounded >> 13);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// half <-> float for n values
+////////////////////////////////////////////////////////////////////////////////////
+void halfToFloat(const uint16_t *input, float *output, int n)
+{
+    int i = 0;
+
+#if defined(__F16C__)
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i h = _mm_loadu_si128((const __m128i *)(input + i));
+        _mm256_storeu_ps(output + i, _mm256_cvtph_ps(h));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 4 <= n; i += 4)
+    {
+        float16x4_t h = vreinterpret_f16_u16(vld1_u16(input + i));
+        vst1q_f32(output + i, vcvt_f32_f16(h));
+    }
+#endif
+
+    for (; i < n; ++i)
+        output[i] = halfToFloatScalar(input[i]);
+}
+
+void floatToHalf(const float *input, uint16_t *output, int n)
+{
+    int i = 0;
+
+#if defined(__F16C__)
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(input + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i *)(output + i), h);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 4 <= n; i += 4)
+    {
+        float16x4_t h = vcvt_f16_f32(vld1q_f32(input + i));
+        vst1_u16(output + i, vreinterpret_u16_f16(h));
+    }
+#endif
+
+    for (; i < n; ++i)
+        output[i] = floatToHalfScalar(input[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// fixed point <-> float for n values (rounded and saturated; the loops are
+// simple enough for the auto-vectorizer)
+////////////////////////////////////////////////////////////////////////////////////
+void fixedToFloat(const int16_t *input, float *output, int n)
+{
+    const float scale = 1.0f / (1 << FIXED16_FRACTION_BITS);
+
+    for (int i = 0; i < n; ++i)
+        output[i] = input[i] * scale;
+}
+
+void floatToFixed(const float *input, int16_t *output, int n)
+{
+    const float scale = float(1 << FIXED16_FRACTION_BITS);
+
+    for (int i = 0; i < n; ++i)
+    {
+        float value = input[i] * scale;
+        value = value < -32768.0f ? -32768.0f : (value > 32767.0f ? 32767.0f : value);
+        output[i] = int16_t(lrintf(value));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// row access for intermediate images
+////////////////////////////////////////////////////////////////////////////////////
+bool isIntermediateType(int type)
+{
+    return type == CV_8U || type == CV_16U || type == CV_32F || type == CV_16S;
+}
+
+void loadRow(const cv::Mat &image, int row, float *output)
+{
+    int cols = image.cols;
+
+    switch (image.type())
+    {
+    case CV_8U:
+    {
+        const uchar *pImage = image.ptr<uchar>(row);
+        for (int c = 0; c < cols; ++c)
+            output[c] = pImage[c];
+        break;
+    }
+    case CV_16U:
+    {
+        const uint16_t *pImage = image.ptr<uint16_t>(row);
+        for (int c = 0; c < cols; ++c)
+            output[c] = pImage[c];
+        break;
+    }
+    case CV_16S:
+        fixedToFloat(image.ptr<int16_t>(row), output, cols);
+        break;
+    default:
+        memcpy(output, image.ptr<float>(row), cols * sizeof(float));
+        break;
+    }
+}
+
+void storeRow(const float *input, cv::Mat &image, int row)
+{
+    int cols = image.cols;
+
+    switch (image.type())
+    {
+    case CV_8U:
+    {
+        uchar *pImage = image.ptr<uchar>(row);
+        for (int c = 0; c < cols; ++c)
+            pImage[c] = cv::saturate_cast<uchar>(input[c]);
+        break;
+    }
+    case CV_16U:
+    {
+        uint16_t *pImage = image.ptr<uint16_t>(row);
+        for (int c = 0; c < cols; ++c)
+            pImage[c] = cv::saturate_cast<uint16_t>(input[c]);
+        break;
+    }
+    case CV_16S:
+        floatToFixed(input, image.ptr<int16_t>(row), cols);
+        break;
+    default:
+        memcpy(image.ptr<float>(row), input, cols * sizeof(float));
+        break;
+    }
+}
+
+void loadRow(const HalfImage &image, int row, float *output)
+{
+    halfToFloat(image.bits.ptr<uint16_t>(row), output, image.bits.cols);
+}
+
+void storeRow(const float *input, HalfImage &image, int row)
+{
+    floatToHalf(input, image.bits.ptr<uint16_t>(row), image.bits.cols);
+}
@@ -0,0 +1,50 @@
+#ifndef FLOAT16_H
+#define FLOAT16_H
+
+#include <stdint.h>
+
+#include <opencv2/core/core.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////
+// 16 bit storage for intermediate images of multi-stage filter pipelines; the
+// arithmetic stays in float, only loads and stores convert
+//
+// OpenCV 2.4 has no CV_16F, so half precision images are HalfImages: a CV_16U
+// matrix that holds IEEE binary16 bit patterns. The own type keeps them apart
+// from genuine 16 bit unsigned images, which are read as integers. CV_16S
+// images hold fixed point numbers with FIXED16_FRACTION_BITS fractional bits
+// (range -256 .. 256, step 1/128)
+////////////////////////////////////////////////////////////////////////////////////
+#define FIXED16_FRACTION_BITS 7
+
+struct HalfImage
+{
+    cv::Mat bits;  // CV_16U
+};
+
+// convert n values; uses F16C (x86) or NEON (ARMv8) if the compiler enables it
+void halfToFloat(const uint16_t *input, float *output, int n);
+void floatToHalf(const float *input, uint16_t *output, int n);
+
+void fixedToFloat(const int16_t *input, float *output, int n);
+void floatToFixed(const float *input, int16_t *output, int n);
+
+// load one row of a CV_8U, CV_16U, CV_32F or fixed point (CV_16S) image as
+// float, and store a float row into such an image (CV_16U saturates)
+void loadRow(const cv::Mat &image, int row, float *output);
+void storeRow(const float *input, cv::Mat &image, int row);
+
+// same for half precision images
+void loadRow(const HalfImage &image, int row, float *output);
+void storeRow(const float *input, HalfImage &image, int row);
+
+// true for the types loadRow and storeRow support
+bool isIntermediateType(int type);
+
+// the matrix behind an image, so that templates can handle both kinds
+inline const cv::Mat &storage(const cv::Mat &image) { return image; }
+inline cv::Mat &storage(cv::Mat &image) { return image; }
+inline const cv::Mat &storage(const HalfImage &image) { return image.bits; }
+inline cv::Mat &storage(HalfImage &image) { return image.bits; }
+
+#endif /* FLOAT16_H */
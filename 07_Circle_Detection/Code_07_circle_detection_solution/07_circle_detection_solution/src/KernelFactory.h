@@ -0,0 +1,126 @@
+#ifndef KERNELFACTORY_H
+#define KERNELFACTORY_H
+
+#include <opencv2/core/core.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////
+// compile-time factory for separable Binomial and Sobel kernels of any odd size
+//
+// usage:
+//     constexpr kernels::Kernel1D<float, 7> b7 = kernels::binomialNormalized<float, 7>();
+//     cv::Mat b7Mat = kernels::toMat(b7, false); // 1 x 7, CV_32F
+//
+// the integer variants hold the raw coefficients (choose a type that is wide
+// enough, e.g. int up to size 31); the normalized variants sum up to 1
+// (Binomial) or have an absolute sum of 1 (derivative)
+////////////////////////////////////////////////////////////////////////////////////
+namespace kernels
+{
+
+// fixed-size 1D kernel that can be built and read at compile time
+template <typename T, int N>
+struct Kernel1D
+{
+    T values[N];
+
+    constexpr T operator[](int i) const { return values[i]; }
+    constexpr int size() const { return N; }
+};
+
+// Binomial Coefficient (n over k); linear recursion instead of Pascal's rule
+constexpr long long binomialCoefficient(int n, int k)
+{
+    return (k == 0) ? 1 : binomialCoefficient(n, k - 1) * (n - k + 1) / k;
+}
+
+// sum of a Binomial row of the given size: 2^(size-1)
+constexpr long long binomialSum(int size)
+{
+    return 1LL << (size - 1);
+}
+
+// derivative part of the Sobel kernel: -size/2, ..., 0, ..., size/2
+constexpr long long derivativeTap(int size, int i)
+{
+    return i - size / 2;
+}
+
+// sum of the absolute derivative taps: h * (h + 1) with h = size / 2
+constexpr long long derivativeAbsSum(int size)
+{
+    return (size / 2) * (size / 2 + 1);
+}
+
+// index sequence (C++11 has no std::index_sequence)
+template <int... Is>
+struct IndexSequence {};
+
+template <int N, int... Is>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, Is...> {};
+
+template <int... Is>
+struct MakeIndexSequence<0, Is...>
+{
+    typedef IndexSequence<Is...> type;
+};
+
+template <typename T, int N, int... Is>
+constexpr Kernel1D<T, N> makeBinomial(IndexSequence<Is...>, long long divisor)
+{
+    return Kernel1D<T, N>{{ T(T(binomialCoefficient(N - 1, Is)) / T(divisor))... }};
+}
+
+template <typename T, int N, int... Is>
+constexpr Kernel1D<T, N> makeDerivative(IndexSequence<Is...>, long long divisor)
+{
+    return Kernel1D<T, N>{{ T(T(derivativeTap(N, Is)) / T(divisor))... }};
+}
+
+// Binomial row: 1, N-1, ..., N-1, 1
+template <typename T, int N>
+constexpr Kernel1D<T, N> binomial()
+{
+    static_assert(N % 2 == 1, "kernel size must be odd");
+    return makeBinomial<T, N>(typename MakeIndexSequence<N>::type(), 1);
+}
+
+// Binomial row divided by its sum (use a floating point type)
+template <typename T, int N>
+constexpr Kernel1D<T, N> binomialNormalized()
+{
+    static_assert(N % 2 == 1, "kernel size must be odd");
+    return makeBinomial<T, N>(typename MakeIndexSequence<N>::type(), binomialSum(N));
+}
+
+// Sobel derivative row: -N/2, ..., N/2
+template <typename T, int N>
+constexpr Kernel1D<T, N> sobelDerivative()
+{
+    static_assert(N % 2 == 1, "kernel size must be odd");
+    return makeDerivative<T, N>(typename MakeIndexSequence<N>::type(), 1);
+}
+
+// Sobel derivative row divided by its absolute sum (use a floating point type)
+template <typename T, int N>
+constexpr Kernel1D<T, N> sobelDerivativeNormalized()
+{
+    static_assert(N % 2 == 1, "kernel size must be odd");
+    return makeDerivative<T, N>(typename MakeIndexSequence<N>::type(), derivativeAbsSum(N));
+}
+
+// copy a kernel to a cv::Mat (1 x N, or N x 1 if transposed)
+template <typename T, int N>
+cv::Mat toMat(const Kernel1D<T, N> &kernel, bool transpose)
+{
+    cv::Mat mat = transpose ? cv::Mat(N, 1, cv::DataType<T>::type) : cv::Mat(1, N, cv::DataType<T>::type);
+
+    T *pMat = mat.ptr<T>(0);
+    for (int i = 0; i < N; ++i)
+        pMat[i] = kernel[i];
+
+    return mat;
+}
+
+} // namespace kernels
+
+#endif /* KERNELFACTORY_H */
@@ -1,10 +1,27 @@
 #include <iostream>
 #include <math.h>
+#include <algorithm>
+#include <float.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
 #include "Morphology.h"
+#include "Parallel.h"
+#include "Workspace.h"
+
+static void buildThinningTable(uchar table[2][256]);
 
 ////////////////////////////////////////////////////////////////////////////////////
 // constructor. initialize the kernels
@@ -33,10 +50,36 @@ Morphology::Morphology()
         255, 255, 255, 255,
         255, 255, 255, 255 };
     kernel4x4Full = cv::Mat(4, 4, CV_8U, kernel4x4_full).clone();
+
+    engine = MorphologyEngine::Default;
+
+    buildThinningTable(thinningTable);
+
+    workspace = 0;
 }
 
 Morphology::~Morphology(){}
 
+void Morphology::setWorkspace(Workspace *workspace)
+{
+    this->workspace = workspace;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// temporary image from the workspace (or a new one without a workspace)
+////////////////////////////////////////////////////////////////////////////////////
+cv::Mat Morphology::temporary(int rows, int cols, int type)
+{
+    if (workspace)
+        return workspace->acquire(rows, cols, type);
+    return cv::Mat(rows, cols, type);
+}
+
+void Morphology::setEngine(MorphologyEngine engine)
+{
+    this->engine = engine;
+}
+
 cv::Mat Morphology::getKernelPlus()
 {
     return kernel3x3Plus;
@@ -62,6 +105,54 @@ void Morphology::dilate(const cv::Mat &input, cv::Mat &output, const cv::Mat &ke
         return;
     }
 
+    int radius;
+
+    if (engine == MorphologyEngine::BitPacked)
+        dilateErodeBitPacked(input, output, kernel, true);
+    else if (isFullRect(kernel))
+        dilateErodeRect(input, output, kernel.rows, kernel.cols, true);
+    else if (isDisk(kernel, radius) && radius >= 2)
+        dilateErodeDisk(input, output, radius, true);
+    else
+    {
+        const Decomposition &decomposition = decompose(kernel);
+
+        if (decomposition.parts.empty())
+            dilateDirect(input, output, kernel);
+        else
+            dilateErodeDecomposed(input, output, kernel.rows, kernel.cols, decomposition.parts, true);
+    }
+}
+
+void Morphology::erode(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    if (input.empty() || kernel.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    int radius;
+
+    if (engine == MorphologyEngine::BitPacked)
+        dilateErodeBitPacked(input, output, kernel, false);
+    else if (isFullRect(kernel))
+        dilateErodeRect(input, output, kernel.rows, kernel.cols, false);
+    else if (isDisk(kernel, radius) && radius >= 2)
+        dilateErodeDisk(input, output, radius, false);
+    else
+    {
+        const Decomposition &decomposition = decompose(kernel);
+
+        if (decomposition.parts.empty())
+            erodeDirect(input, output, kernel);
+        else
+            dilateErodeDecomposed(input, output, kernel.rows, kernel.cols, decomposition.parts, false);
+    }
+}
+
+void Morphology::dilateDirect(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
     int rows = input.rows;
     int cols = input.cols;
 
@@ -71,8 +162,10 @@ void Morphology::dilate(const cv::Mat &input, cv::Mat &output, const cv::Mat &ke
     int refPointX = (kCols - 1) / 2; 
     int refPointY = (kRows - 1) / 2;
 
-    output.release();
-    output = cv::Mat::zeros(rows, cols, CV_8U);
+    // only the area written by the loops below is not cleared
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+    Workspace::clearBorder(output, refPointY, rows - refPointY - std::max(rows - kRows, 0),
+                           refPointX, cols - refPointX - std::max(cols - kCols, 0));
 
     for (int r = 0; r < rows - kRows; ++r)
     {
@@ -106,14 +199,8 @@ void Morphology::dilate(const cv::Mat &input, cv::Mat &output, const cv::Mat &ke
     }
 }
 
-void Morphology::erode(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+void Morphology::erodeDirect(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
 {
-    if (input.empty() || kernel.empty())
-    {
-        std::cout << "One ore more inputs are empty!" << std::endl;
-        return;
-    }
-
     int rows = input.rows;
     int cols = input.cols;
 
@@ -123,8 +210,10 @@ void Morphology::erode(const cv::Mat &input, cv::Mat &output, const cv::Mat &ker
     int refPointX = (kCols - 1) / 2; 
     int refPointY = (kRows - 1) / 2;
 
-    output.release();
-    output = cv::Mat::zeros(rows, cols, CV_8U);
+    // only the area written by the loops below is not cleared
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+    Workspace::clearBorder(output, refPointY, rows - refPointY - std::max(rows - kRows, 0),
+                           refPointX, cols - refPointX - std::max(cols - kCols, 0));
 
     for (int r = 0; r < rows - kRows; ++r)
     {
@@ -175,8 +264,8 @@ void Morphology::subtract(const cv::Mat &input, cv::Mat &output, const cv::Mat &
         return;
     }
 
-    output.release();
-    output = cv::Mat::zeros(rows, cols, CV_8U);
+    // every pixel is written, no zero-fill needed
+    output.create(rows, cols, CV_8U);
 
     if (input.isContinuous() && output.isContinuous() && subtract.isContinuous())
     {
@@ -197,3 +286,1833 @@ void Morphology::subtract(const cv::Mat &input, cv::Mat &output, const cv::Mat &
         }
     }
 }
+
+////////////////////////////////////////////////////////////////////////////////////
+// true if every element of the kernel is set (getKernelFull, getKernelLine)
+////////////////////////////////////////////////////////////////////////////////////
+bool Morphology::isFullRect(const cv::Mat &kernel)
+{
+    for (int r = 0; r < kernel.rows; ++r)
+    {
+        const uchar *pKernel = kernel.ptr<uchar>(r);
+
+        for (int c = 0; c < kernel.cols; ++c)
+        {
+            if (pKernel[c] == 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// van Herk/Gil-Werman running maximum (or minimum) over windows of w
+// elements: g is the running extreme from the start of every block of w
+// elements, h the one from the end of the block; window c = [c, c + w - 1]
+// spans at most two blocks, so its extreme is extreme(h[c], g[c + w - 1]).
+// About 3 comparisons per element, independent of w
+template <bool Max>
+static inline uchar extreme(uchar a, uchar b)
+{
+    return Max ? (a > b ? a : b) : (a < b ? a : b);
+}
+
+template <bool Max>
+static void runningExtreme(const uchar *input, uchar *output, int n, int w, uchar *g, uchar *h)
+{
+    // block by block, so no index needs a modulo
+    for (int start = 0; start < n; start += w)
+    {
+        int end = std::min(start + w, n);
+
+        g[start] = input[start];
+        for (int i = start + 1; i < end; ++i)
+            g[i] = extreme<Max>(g[i - 1], input[i]);
+
+        h[end - 1] = input[end - 1];
+        for (int i = end - 2; i >= start; --i)
+            h[i] = extreme<Max>(h[i + 1], input[i]);
+    }
+
+    for (int c = 0; c + w <= n; ++c)
+        output[c] = extreme<Max>(h[c], g[c + w - 1]);
+}
+
+// the same along the columns (first cols columns), with whole rows as elements;
+// g and h need at least input.rows x cols elements
+template <bool Max>
+static void runningExtremeRows(const cv::Mat &input, cv::Mat &output, int outRows, int cols, int offsetX,
+                               int offsetY, int w, cv::Mat &g, cv::Mat &h)
+{
+    int n = input.rows;
+
+    for (int start = 0; start < n; start += w)
+    {
+        int end = std::min(start + w, n);
+
+        memcpy(g.ptr<uchar>(start), input.ptr<uchar>(start), cols);
+        for (int i = start + 1; i < end; ++i)
+        {
+            const uchar *pInput = input.ptr<uchar>(i);
+            const uchar *pPrevious = g.ptr<uchar>(i - 1);
+            uchar *pG = g.ptr<uchar>(i);
+
+            for (int c = 0; c < cols; ++c)
+                pG[c] = extreme<Max>(pPrevious[c], pInput[c]);
+        }
+
+        memcpy(h.ptr<uchar>(end - 1), input.ptr<uchar>(end - 1), cols);
+        for (int i = end - 2; i >= start; --i)
+        {
+            const uchar *pInput = input.ptr<uchar>(i);
+            const uchar *pNext = h.ptr<uchar>(i + 1);
+            uchar *pH = h.ptr<uchar>(i);
+
+            for (int c = 0; c < cols; ++c)
+                pH[c] = extreme<Max>(pNext[c], pInput[c]);
+        }
+    }
+
+    for (int r = 0; r < outRows; ++r)
+    {
+        const uchar *pH = h.ptr<uchar>(r);
+        const uchar *pG = g.ptr<uchar>(r + w - 1);
+        uchar *pOutput = output.ptr<uchar>(r + offsetY) + offsetX;
+
+        for (int c = 0; c < cols; ++c)
+            pOutput[c] = extreme<Max>(pH[c], pG[c]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// dilation / erosion with a full kRows x kCols kernel as a horizontal and a
+// vertical running max / min. Same result as the direct implementation
+// (binary output, reference point, written area and zero border)
+////////////////////////////////////////////////////////////////////////////////////
+void Morphology::dilateErodeRect(const cv::Mat &input, cv::Mat &output, int kRows, int kCols, bool dilation)
+{
+    int rows = input.rows;
+    int cols = input.cols;
+
+    int refPointX = (kCols - 1) / 2;
+    int refPointY = (kRows - 1) / 2;
+
+    // the direct implementation writes the positions r < rows - kRows and
+    // c < cols - kCols
+    int outRows = std::max(rows - kRows, 0);
+    int outCols = std::max(cols - kCols, 0);
+
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+    Workspace::clearBorder(output, refPointY, rows - refPointY - outRows, refPointX, cols - refPointX - outCols);
+
+    if (outRows == 0 || outCols == 0)
+        return;
+
+    // horizontal pass on the binarized rows that are used by the windows
+    int usedRows = outRows + kRows - 1;
+    int usedCols = outCols + kCols - 1;
+    cv::Mat horizontal = temporary(usedRows, outCols + 1, CV_8U);
+    cv::Mat binary = temporary(1, usedCols, CV_8U);
+
+    // the first rows of g and h serve the horizontal pass as well
+    cv::Mat g = temporary(usedRows, usedCols, CV_8U);
+    cv::Mat h = temporary(usedRows, usedCols, CV_8U);
+
+    uchar *pBinary = binary.ptr<uchar>(0);
+    for (int r = 0; r < usedRows; ++r)
+    {
+        const uchar *pInput = input.ptr<uchar>(r);
+        for (int c = 0; c < usedCols; ++c)
+            pBinary[c] = pInput[c] > 0 ? 255 : 0;
+
+        if (dilation)
+            runningExtreme<true>(pBinary, horizontal.ptr<uchar>(r), usedCols, kCols, g.ptr<uchar>(0), h.ptr<uchar>(0));
+        else
+            runningExtreme<false>(pBinary, horizontal.ptr<uchar>(r), usedCols, kCols, g.ptr<uchar>(0), h.ptr<uchar>(0));
+    }
+
+    // vertical pass
+    if (dilation)
+        runningExtremeRows<true>(horizontal, output, outRows, outCols, refPointX, refPointY, kRows, g, h);
+    else
+        runningExtremeRows<false>(horizontal, output, outRows, outCols, refPointX, refPointY, kRows, g, h);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// bit-packed binary morphology: every row is packed into 64 bit words (bit i
+// of word j is pixel 64 * j + i, set for values > 0). A kernel element at
+// (kr, kc) contributes row r + kr shifted by kc bits, so one OR (dilation) or
+// AND (erosion) handles 64 pixels. Same results as the direct implementation
+////////////////////////////////////////////////////////////////////////////////////
+
+// word j of a packed row shifted towards bit 0 by shift bits
+static inline uint64_t shiftedWord(const uint64_t *pRow, int words, int j, int shift)
+{
+    int wordOffset = shift >> 6;
+    int bitOffset = shift & 63;
+
+    uint64_t low = j + wordOffset < words ? pRow[j + wordOffset] : 0;
+    if (bitOffset == 0)
+        return low;
+
+    uint64_t high = j + wordOffset + 1 < words ? pRow[j + wordOffset + 1] : 0;
+    return (low >> bitOffset) | (high << (64 - bitOffset));
+}
+
+void Morphology::dilateErodeBitPacked(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel, bool dilation)
+{
+    int rows = input.rows;
+    int cols = input.cols;
+
+    int kRows = kernel.rows;
+    int kCols = kernel.cols;
+
+    int refPointX = (kCols - 1) / 2;
+    int refPointY = (kRows - 1) / 2;
+
+    int outRows = std::max(rows - kRows, 0);
+    int outCols = std::max(cols - kCols, 0);
+
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+    Workspace::clearBorder(output, refPointY, rows - refPointY - outRows, refPointX, cols - refPointX - outCols);
+
+    if (outRows == 0 || outCols == 0)
+        return;
+
+    // pack the input rows (a CV_8U temporary, 8 bytes per word)
+    int words = (cols + 63) / 64;
+    cv::Mat packed = temporary(rows, words * 8, CV_8U);
+    packed.setTo(0);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        const uchar *pInput = input.ptr<uchar>(r);
+        uint64_t *pPacked = packed.ptr<uint64_t>(r);
+
+        for (int c = 0; c < cols; ++c)
+        {
+            if (pInput[c] > 0)
+                pPacked[c >> 6] |= uint64_t(1) << (c & 63);
+        }
+    }
+
+    // kernel elements: x is the shift, y the row
+    kernelOffsets.clear();
+    for (int kr = 0; kr < kRows; ++kr)
+    {
+        const uchar *pKernel = kernel.ptr<uchar>(kr);
+
+        for (int kc = 0; kc < kCols; ++kc)
+        {
+            if (pKernel[kc] > 0)
+                kernelOffsets.push_back(cv::Point(kc, kr));
+        }
+    }
+
+    int nElements = int(kernelOffsets.size());
+    int outWords = (outCols + 63) / 64;
+    cv::Mat resultRow = temporary(1, outWords * 8, CV_8U);
+    uint64_t *result = resultRow.ptr<uint64_t>(0);
+
+    for (int r = 0; r < outRows; ++r)
+    {
+        // an empty kernel finds nothing: dilation gives 0, erosion 255
+        uint64_t initial = dilation ? 0 : ~uint64_t(0);
+        std::fill(result, result + outWords, initial);
+
+        for (int e = 0; e < nElements; ++e)
+        {
+            const uint64_t *pRow = packed.ptr<uint64_t>(r + kernelOffsets[e].y);
+            int shift = kernelOffsets[e].x;
+
+            if (dilation)
+            {
+                for (int j = 0; j < outWords; ++j)
+                    result[j] |= shiftedWord(pRow, words, j, shift);
+            }
+            else
+            {
+                for (int j = 0; j < outWords; ++j)
+                    result[j] &= shiftedWord(pRow, words, j, shift);
+            }
+        }
+
+        // unpack into the output row
+        uchar *pOutput = output.ptr<uchar>(r + refPointY) + refPointX;
+        for (int c = 0; c < outCols; ++c)
+            pOutput[c] = ((result[c >> 6] >> (c & 63)) & 1) ? 255 : 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// structuring element decomposition
+//
+// dilation distributes over the union of kernels and a dilation with the
+// Minkowski sum A + B equals a dilation with A followed by one with B (the
+// same holds for erosion). dilate and erode rewrite
+//   - a plus shaped kernel (one full row and one full column) as the union of
+//     a horizontal and a vertical line
+//   - an octagon (getKernelOctagon) as a chain of 3x3 kernels
+// full rectangles already use the separated running min/max (dilateErodeRect)
+////////////////////////////////////////////////////////////////////////////////////
+
+// Minkowski sum of two kernels (top left aligned)
+static cv::Mat minkowskiSum(const cv::Mat &a, const cv::Mat &b)
+{
+    cv::Mat sum = cv::Mat::zeros(a.rows + b.rows - 1, a.cols + b.cols - 1, CV_8U);
+
+    for (int ar = 0; ar < a.rows; ++ar)
+        for (int ac = 0; ac < a.cols; ++ac)
+            if (a.at<uchar>(ar, ac) > 0)
+                for (int br = 0; br < b.rows; ++br)
+                    for (int bc = 0; bc < b.cols; ++bc)
+                        if (b.at<uchar>(br, bc) > 0)
+                            sum.at<uchar>(ar + br, ac + bc) = 255;
+
+    return sum;
+}
+
+static bool equalKernels(const cv::Mat &a, const cv::Mat &b)
+{
+    if (a.rows != b.rows || a.cols != b.cols)
+        return false;
+
+    for (int r = 0; r < a.rows; ++r)
+        for (int c = 0; c < a.cols; ++c)
+            if ((a.at<uchar>(r, c) > 0) != (b.at<uchar>(r, c) > 0))
+                return false;
+
+    return true;
+}
+
+cv::Mat Morphology::getKernelOctagon(int radius)
+{
+    cv::Mat octagon = kernel3x3Full.clone();
+
+    for (int i = 1; i < radius; ++i)
+        octagon = minkowskiSum(octagon, i % 2 ? kernel3x3Plus : kernel3x3Full);
+
+    return octagon;
+}
+
+const Morphology::Decomposition &Morphology::decompose(const cv::Mat &kernel)
+{
+    int kRows = kernel.rows;
+    int kCols = kernel.cols;
+
+    // already analyzed?
+    for (size_t i = 0; i < decompositionCache.size(); ++i)
+    {
+        if (equalKernels(decompositionCache[i].kernel, kernel))
+            return decompositionCache[i];
+    }
+
+    Decomposition entry;
+    entry.kernel = kernel.clone();
+
+    // plus: exactly one full row and one full column, nothing else
+    int fullRow = -1, fullCol = -1, nFullRows = 0, nFullCols = 0;
+    for (int r = 0; r < kRows; ++r)
+    {
+        int count = 0;
+        for (int c = 0; c < kCols; ++c)
+            count += kernel.at<uchar>(r, c) > 0;
+
+        if (count == kCols)
+        {
+            fullRow = r;
+            ++nFullRows;
+        }
+    }
+    for (int c = 0; c < kCols; ++c)
+    {
+        int count = 0;
+        for (int r = 0; r < kRows; ++r)
+            count += kernel.at<uchar>(r, c) > 0;
+
+        if (count == kRows)
+        {
+            fullCol = c;
+            ++nFullCols;
+        }
+    }
+
+    bool plus = kRows > 1 && kCols > 1 && nFullRows == 1 && nFullCols == 1;
+    for (int r = 0; r < kRows && plus; ++r)
+        for (int c = 0; c < kCols; ++c)
+            if (kernel.at<uchar>(r, c) > 0 && r != fullRow && c != fullCol)
+                plus = false;
+
+    if (plus)
+    {
+        KernelPart horizontal, vertical;
+        horizontal.offsetRow = fullRow;
+        horizontal.offsetCol = 0;
+        horizontal.chain.push_back(cv::Mat(1, kCols, CV_8U, cv::Scalar(255)));
+
+        vertical.offsetRow = 0;
+        vertical.offsetCol = fullCol;
+        vertical.chain.push_back(cv::Mat(kRows, 1, CV_8U, cv::Scalar(255)));
+
+        entry.parts.push_back(horizontal);
+        entry.parts.push_back(vertical);
+    }
+    else if (kRows == kCols && kRows >= 5 && kRows % 2 == 1 && equalKernels(kernel, getKernelOctagon(kRows / 2)))
+    {
+        KernelPart octagon;
+        octagon.offsetRow = 0;
+        octagon.offsetCol = 0;
+
+        for (int i = 0; i < kRows / 2; ++i)
+            octagon.chain.push_back(i % 2 ? kernel3x3Plus : kernel3x3Full);
+
+        entry.parts.push_back(octagon);
+    }
+
+    if (decompositionCache.size() >= 32)
+        decompositionCache.erase(decompositionCache.begin());
+
+    decompositionCache.push_back(entry);
+    return decompositionCache.back();
+}
+
+// output(t) = max (min) of input(t + q) over the kernel elements q, for all
+// t where the kernel fits into the input (no border, no reference point).
+// output has to be (input.rows - kRows + 1) x (input.cols - kCols + 1); full
+// rectangles use horizontal, g and h (at least input.rows x input.cols)
+template <bool Max>
+static void extremeValid(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel, bool fullRect,
+                         cv::Mat &horizontal, cv::Mat &g, cv::Mat &h)
+{
+    int kRows = kernel.rows;
+    int kCols = kernel.cols;
+    int outRows = output.rows;
+    int outCols = output.cols;
+
+    if (fullRect)
+    {
+        for (int r = 0; r < input.rows; ++r)
+            runningExtreme<Max>(input.ptr<uchar>(r), horizontal.ptr<uchar>(r), input.cols, kCols, g.ptr<uchar>(0),
+                                h.ptr<uchar>(0));
+
+        runningExtremeRows<Max>(horizontal, output, outRows, outCols, 0, 0, kRows, g, h);
+        return;
+    }
+
+    bool first = true;
+    for (int kr = 0; kr < kRows; ++kr)
+    {
+        for (int kc = 0; kc < kCols; ++kc)
+        {
+            if (kernel.at<uchar>(kr, kc) == 0)
+                continue;
+
+            for (int r = 0; r < outRows; ++r)
+            {
+                const uchar *pInput = input.ptr<uchar>(r + kr) + kc;
+                uchar *pOutput = output.ptr<uchar>(r);
+
+                if (first)
+                    memcpy(pOutput, pInput, outCols);
+                else
+                    for (int c = 0; c < outCols; ++c)
+                        pOutput[c] = extreme<Max>(pOutput[c], pInput[c]);
+            }
+            first = false;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// run a decomposed kernel: every part is evaluated as its chain, the parts are
+// combined, and the result is placed like the direct implementation does it
+// (reference point, written area and zero border)
+////////////////////////////////////////////////////////////////////////////////////
+void Morphology::dilateErodeDecomposed(const cv::Mat &input, cv::Mat &output, int kRows, int kCols,
+                                       const std::vector<KernelPart> &parts, bool dilation)
+{
+    int rows = input.rows;
+    int cols = input.cols;
+
+    int refPointX = (kCols - 1) / 2;
+    int refPointY = (kRows - 1) / 2;
+
+    int outRows = std::max(rows - kRows, 0);
+    int outCols = std::max(cols - kCols, 0);
+
+    cv::Mat binary = temporary(rows, cols, CV_8U);
+    for (int r = 0; r < rows; ++r)
+    {
+        const uchar *pInput = input.ptr<uchar>(r);
+        uchar *pBinary = binary.ptr<uchar>(r);
+
+        for (int c = 0; c < cols; ++c)
+            pBinary[c] = pInput[c] > 0 ? 255 : 0;
+    }
+
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+    Workspace::clearBorder(output, refPointY, rows - refPointY - outRows, refPointX, cols - refPointX - outCols);
+
+    if (outRows == 0 || outCols == 0)
+        return;
+
+    // scratch of the running min/max, shared by all chain elements
+    cv::Mat horizontal = temporary(rows, cols, CV_8U);
+    cv::Mat g = temporary(rows, cols, CV_8U);
+    cv::Mat h = temporary(rows, cols, CV_8U);
+
+    for (size_t p = 0; p < parts.size(); ++p)
+    {
+        cv::Mat current = binary;
+
+        for (size_t i = 0; i < parts[p].chain.size(); ++i)
+        {
+            const cv::Mat &element = parts[p].chain[i];
+            cv::Mat next = temporary(current.rows - element.rows + 1, current.cols - element.cols + 1, CV_8U);
+
+            if (dilation)
+                extremeValid<true>(current, next, element, isFullRect(element), horizontal, g, h);
+            else
+                extremeValid<false>(current, next, element, isFullRect(element), horizontal, g, h);
+
+            current = next;
+        }
+
+        for (int r = 0; r < outRows; ++r)
+        {
+            const uchar *pPart = current.ptr<uchar>(r + parts[p].offsetRow) + parts[p].offsetCol;
+            uchar *pOutput = output.ptr<uchar>(r + refPointY) + refPointX;
+
+            if (p == 0)
+                memcpy(pOutput, pPart, outCols);
+            else if (dilation)
+                for (int c = 0; c < outCols; ++c)
+                    pOutput[c] = extreme<true>(pOutput[c], pPart[c]);
+            else
+                for (int c = 0; c < outCols; ++c)
+                    pOutput[c] = extreme<false>(pOutput[c], pPart[c]);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// fused operators
+//
+// morphologyRow computes one row of dilate/erode (reference point and written
+// area as above) from the kRows rows starting at pRows; the operators below
+// combine these rows directly instead of going through full intermediates
+////////////////////////////////////////////////////////////////////////////////////
+static void morphologyRow(const uchar *const *pRows, int cols, const std::vector<cv::Point> &elements, int kCols,
+                          bool dilation, uchar *pOutput)
+{
+    int refPointX = (kCols - 1) / 2;
+    int outCols = std::max(cols - kCols, 0);
+
+    memset(pOutput, 0, cols);
+    uchar *pResult = pOutput + refPointX;
+
+    // running max/min over the kernel elements, binarized at the end
+    memset(pResult, dilation ? 0 : 255, outCols);
+    for (size_t e = 0; e < elements.size(); ++e)
+    {
+        const uchar *pInput = pRows[elements[e].y] + elements[e].x;
+
+        if (dilation)
+            for (int c = 0; c < outCols; ++c)
+                pResult[c] = std::max(pResult[c], pInput[c]);
+        else
+            for (int c = 0; c < outCols; ++c)
+                pResult[c] = std::min(pResult[c], pInput[c]);
+    }
+
+    for (int c = 0; c < outCols; ++c)
+        pResult[c] = pResult[c] > 0 ? 255 : 0;
+}
+
+static void kernelElements(const cv::Mat &kernel, std::vector<cv::Point> &elements)
+{
+    elements.clear();
+    for (int kr = 0; kr < kernel.rows; ++kr)
+    {
+        const uchar *pKernel = kernel.ptr<uchar>(kr);
+
+        for (int kc = 0; kc < kernel.cols; ++kc)
+            if (pKernel[kc] > 0)
+                elements.push_back(cv::Point(kc, kr));
+    }
+}
+
+// full rectangles beyond 3x3 and disks from radius 2 on have an O(1) per pixel
+// engine (running min/max, distance transform); for them two separate passes
+// beat morphologyRow's O(kernel elements) per pixel
+bool Morphology::hasFastEngine(const cv::Mat &kernel)
+{
+    int radius;
+    return (isFullRect(kernel) && kernel.rows * kernel.cols > 9) || (isDisk(kernel, radius) && radius >= 2);
+}
+
+void Morphology::boundary(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    boundaryGradient(input, output, kernel, false);
+}
+
+void Morphology::gradient(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    boundaryGradient(input, output, kernel, true);
+}
+
+void Morphology::open(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    openClose(input, output, kernel, false);
+}
+
+void Morphology::close(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    openClose(input, output, kernel, true);
+}
+
+// at most one band of rows per pool thread, each at least minRows rows; the
+// band index selects the scratch rows of a band
+static int bandCount(int rows, int minRows)
+{
+    int bands = std::min(ThreadPool::instance().getThreads(), (rows + minRows - 1) / minRows);
+    return std::max(bands, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// boundary and gradient: every output row only needs the kRows input rows of
+// its window, so the eroded (and dilated) row lives in a single row buffer
+////////////////////////////////////////////////////////////////////////////////////
+void Morphology::boundaryGradient(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel, bool gradient)
+{
+    if (input.empty() || kernel.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    int rows = input.rows;
+    int cols = input.cols;
+
+    if (hasFastEngine(kernel))
+    {
+        cv::Mat eroded = temporary(rows, cols, CV_8U);
+        erode(input, eroded, kernel);
+
+        if (gradient)
+        {
+            cv::Mat dilated = temporary(rows, cols, CV_8U);
+            dilate(input, dilated, kernel);
+            subtract(dilated, output, eroded);
+        }
+        else
+            subtract(input, output, eroded);
+        return;
+    }
+
+    int kRows = kernel.rows;
+    int kCols = kernel.cols;
+    int refPointY = (kRows - 1) / 2;
+    int outRows = std::max(rows - kRows, 0);
+
+    kernelElements(kernel, kernelOffsets);
+
+    // every row is written below
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+
+    // an eroded and a dilated row and kRows row pointers per band
+    int bands = bandCount(rows, 16);
+    int bandRows = (rows + bands - 1) / bands;
+    cv::Mat rowBuffers = temporary(2 * bands, cols, CV_8U);
+    rowPointers.resize(bands * kRows);
+
+    parallel_for(0, bands, [&](int bandBegin, int bandEnd)
+    {
+        for (int band = bandBegin; band < bandEnd; ++band)
+        {
+            uchar *eroded = rowBuffers.ptr<uchar>(2 * band);
+            uchar *dilated = rowBuffers.ptr<uchar>(2 * band + 1);
+            const uchar **pRows = &rowPointers[band * kRows];
+            int rowEnd = std::min((band + 1) * bandRows, rows);
+
+            for (int y = band * bandRows; y < rowEnd; ++y)
+            {
+                int r = y - refPointY;
+                bool inside = r >= 0 && r < outRows;
+
+                if (inside)
+                {
+                    for (int kr = 0; kr < kRows; ++kr)
+                        pRows[kr] = input.ptr<uchar>(r + kr);
+
+                    morphologyRow(pRows, cols, kernelOffsets, kCols, false, eroded);
+                    if (gradient)
+                        morphologyRow(pRows, cols, kernelOffsets, kCols, true, dilated);
+                }
+                else
+                {
+                    memset(eroded, 0, cols);
+                    memset(dilated, 0, cols);
+                }
+
+                // boundary: input - eroded, gradient: dilated - eroded (saturated)
+                const uchar *pMinuend = gradient ? dilated : input.ptr<uchar>(y);
+                uchar *pOutput = output.ptr<uchar>(y);
+
+                for (int c = 0; c < cols; ++c)
+                {
+                    int value = pMinuend[c] - eroded[c];
+                    pOutput[c] = value > 0 ? value : 0;
+                }
+            }
+        }
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// opening and closing: the rows of the first operation are kept in a ring of
+// kRows rows (slot y % kRows); each band of output rows fills its own ring
+////////////////////////////////////////////////////////////////////////////////////
+void Morphology::openClose(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel, bool closing)
+{
+    if (input.empty() || kernel.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    int rows = input.rows;
+    int cols = input.cols;
+
+    if (hasFastEngine(kernel))
+    {
+        cv::Mat intermediate = temporary(rows, cols, CV_8U);
+
+        if (closing)
+        {
+            dilate(input, intermediate, kernel);
+            erode(intermediate, output, kernel);
+        }
+        else
+        {
+            erode(input, intermediate, kernel);
+            dilate(intermediate, output, kernel);
+        }
+        return;
+    }
+
+    int kRows = kernel.rows;
+    int kCols = kernel.cols;
+    int refPointY = (kRows - 1) / 2;
+    int outRows = std::max(rows - kRows, 0);
+
+    kernelElements(kernel, kernelOffsets);
+
+    // every row is written below
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+
+    // a ring and kRows row pointers per band
+    int bands = bandCount(rows, 16);
+    int bandRows = (rows + bands - 1) / bands;
+    cv::Mat rings = temporary(bands * kRows, cols, CV_8U);
+    rowPointers.resize(bands * kRows);
+
+    parallel_for(0, bands, [&](int bandBegin, int bandEnd)
+    {
+        for (int band = bandBegin; band < bandEnd; ++band)
+        {
+            const uchar **pRows = &rowPointers[band * kRows];
+
+            // row y of the intermediate image (closing: dilated, opening: eroded)
+            auto ringRow = [&](int y)
+            {
+                return rings.ptr<uchar>(band * kRows + y % kRows);
+            };
+
+            auto intermediateRow = [&](int y)
+            {
+                uchar *pIntermediate = ringRow(y);
+                int r = y - refPointY;
+
+                if (r < 0 || r >= outRows)
+                {
+                    memset(pIntermediate, 0, cols);
+                    return;
+                }
+
+                for (int kr = 0; kr < kRows; ++kr)
+                    pRows[kr] = input.ptr<uchar>(r + kr);
+                morphologyRow(pRows, cols, kernelOffsets, kCols, closing, pIntermediate);
+            };
+
+            int nextIntermediate = -1;
+            int rowEnd = std::min((band + 1) * bandRows, rows);
+
+            for (int y = band * bandRows; y < rowEnd; ++y)
+            {
+                int r = y - refPointY;
+                uchar *pOutput = output.ptr<uchar>(y);
+
+                if (r < 0 || r >= outRows)
+                {
+                    memset(pOutput, 0, cols);
+                    continue;
+                }
+
+                // window: intermediate rows r .. r + kRows - 1
+                if (nextIntermediate < r)
+                    nextIntermediate = r;
+                for (; nextIntermediate < r + kRows; ++nextIntermediate)
+                    intermediateRow(nextIntermediate);
+
+                for (int kr = 0; kr < kRows; ++kr)
+                    pRows[kr] = ringRow(r + kr);
+                morphologyRow(pRows, cols, kernelOffsets, kCols, !closing, pOutput);
+            }
+        }
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// grayscale morphology
+////////////////////////////////////////////////////////////////////////////////////
+
+// result[c] = max/min(result[c], input[c]) for n values, 16 at a time
+static void extremeRowGray(uchar *result, const uchar *input, int n, bool dilation)
+{
+    int c = 0;
+
+#if defined(__SSE2__)
+    if (dilation)
+        for (; c + 16 <= n; c += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)(result + c));
+            __m128i b = _mm_loadu_si128((const __m128i *)(input + c));
+            _mm_storeu_si128((__m128i *)(result + c), _mm_max_epu8(a, b));
+        }
+    else
+        for (; c + 16 <= n; c += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)(result + c));
+            __m128i b = _mm_loadu_si128((const __m128i *)(input + c));
+            _mm_storeu_si128((__m128i *)(result + c), _mm_min_epu8(a, b));
+        }
+#elif defined(__ARM_NEON)
+    if (dilation)
+        for (; c + 16 <= n; c += 16)
+            vst1q_u8(result + c, vmaxq_u8(vld1q_u8(result + c), vld1q_u8(input + c)));
+    else
+        for (; c + 16 <= n; c += 16)
+            vst1q_u8(result + c, vminq_u8(vld1q_u8(result + c), vld1q_u8(input + c)));
+#endif
+
+    if (dilation)
+        for (; c < n; ++c)
+            result[c] = std::max(result[c], input[c]);
+    else
+        for (; c < n; ++c)
+            result[c] = std::min(result[c], input[c]);
+}
+
+void Morphology::grayOffsets(const cv::Mat &kernel, bool reflected, std::vector<cv::Point> &offsets)
+{
+    int refPointX = (kernel.cols - 1) / 2;
+    int refPointY = (kernel.rows - 1) / 2;
+
+    kernelElements(kernel, offsets);
+    for (size_t e = 0; e < offsets.size(); ++e)
+    {
+        cv::Point offset(offsets[e].x - refPointX, offsets[e].y - refPointY);
+        offsets[e] = reflected ? cv::Point(-offset.x, -offset.y) : offset;
+    }
+
+    // grouped by row for grayExtreme
+    std::sort(offsets.begin(), offsets.end(), [](const cv::Point &a, const cv::Point &b)
+    {
+        return a.y < b.y || (a.y == b.y && a.x < b.x);
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// output(y, x) = max/min over the offsets (sorted by row, see grayOffsets) of
+// input(y + dy, x + dx); every input row is padded once per kernel row with the
+// neutral value (0 for max, 255 for min), so the inner loop runs over whole
+// rows without bounds checks
+////////////////////////////////////////////////////////////////////////////////////
+void Morphology::grayExtreme(const cv::Mat &input, cv::Mat &output, const std::vector<cv::Point> &sorted,
+                             bool dilation)
+{
+    int rows = input.rows;
+    int cols = input.cols;
+    uchar neutral = dilation ? 0 : 255;
+
+    int left = 0, right = 0;
+    for (size_t e = 0; e < sorted.size(); ++e)
+    {
+        left = std::max(left, -sorted[e].x);
+        right = std::max(right, sorted[e].x);
+    }
+
+    // every row is written below
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+
+    // one padded row per band
+    int bands = bandCount(rows, 16);
+    int bandRows = (rows + bands - 1) / bands;
+    cv::Mat paddedRows = temporary(bands, left + cols + right, CV_8U);
+
+    parallel_for(0, bands, [&](int bandBegin, int bandEnd)
+    {
+        for (int band = bandBegin; band < bandEnd; ++band)
+        {
+            uchar *padded = paddedRows.ptr<uchar>(band);
+            memset(padded, neutral, left + cols + right);
+            int rowEnd = std::min((band + 1) * bandRows, rows);
+
+            for (int y = band * bandRows; y < rowEnd; ++y)
+            {
+                uchar *pOutput = output.ptr<uchar>(y);
+                memset(pOutput, neutral, cols);
+
+                for (size_t e = 0; e < sorted.size();)
+                {
+                    int inputRow = y + sorted[e].y;
+                    size_t groupEnd = e;
+                    while (groupEnd < sorted.size() && sorted[groupEnd].y == sorted[e].y)
+                        ++groupEnd;
+
+                    if (inputRow >= 0 && inputRow < rows)
+                    {
+                        memcpy(padded + left, input.ptr<uchar>(inputRow), cols);
+                        for (; e < groupEnd; ++e)
+                            extremeRowGray(pOutput, padded + left + sorted[e].x, cols, dilation);
+                    }
+                    e = groupEnd;
+                }
+            }
+        }
+    });
+}
+
+void Morphology::dilateGray(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    if (input.empty() || kernel.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (input.type() != CV_8U)
+    {
+        std::cout << "Input type is not supported (use CV_8U)!" << std::endl;
+        return;
+    }
+
+    grayOffsets(kernel, false, kernelOffsets);
+    grayExtreme(input, output, kernelOffsets, true);
+}
+
+void Morphology::erodeGray(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    if (input.empty() || kernel.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (input.type() != CV_8U)
+    {
+        std::cout << "Input type is not supported (use CV_8U)!" << std::endl;
+        return;
+    }
+
+    grayOffsets(kernel, false, kernelOffsets);
+    grayExtreme(input, output, kernelOffsets, false);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// top-hat and black-hat: the second step uses the reflected offsets, so the
+// opening never exceeds the input and the closing never falls below it
+////////////////////////////////////////////////////////////////////////////////////
+void Morphology::topHat(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    if (input.empty() || kernel.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (input.type() != CV_8U)
+    {
+        std::cout << "Input type is not supported (use CV_8U)!" << std::endl;
+        return;
+    }
+
+    grayOffsets(kernel, false, kernelOffsets);
+    grayOffsets(kernel, true, reflectedOffsets);
+
+    cv::Mat eroded = temporary(input.rows, input.cols, CV_8U);
+    cv::Mat opened = temporary(input.rows, input.cols, CV_8U);
+    grayExtreme(input, eroded, kernelOffsets, false);
+    grayExtreme(eroded, opened, reflectedOffsets, true);
+    subtract(input, output, opened);
+}
+
+void Morphology::blackHat(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel)
+{
+    if (input.empty() || kernel.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    if (input.type() != CV_8U)
+    {
+        std::cout << "Input type is not supported (use CV_8U)!" << std::endl;
+        return;
+    }
+
+    grayOffsets(kernel, false, kernelOffsets);
+    grayOffsets(kernel, true, reflectedOffsets);
+
+    cv::Mat dilated = temporary(input.rows, input.cols, CV_8U);
+    cv::Mat closed = temporary(input.rows, input.cols, CV_8U);
+    grayExtreme(input, dilated, kernelOffsets, true);
+    grayExtreme(dilated, closed, reflectedOffsets, false);
+    subtract(closed, output, input);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Euclidean distance transform and disk morphology
+////////////////////////////////////////////////////////////////////////////////////
+cv::Mat Morphology::getKernelDisk(int radius)
+{
+    int size = 2 * radius + 1;
+    cv::Mat disk = cv::Mat::zeros(size, size, CV_8U);
+
+    for (int r = 0; r < size; ++r)
+        for (int c = 0; c < size; ++c)
+            if ((r - radius) * (r - radius) + (c - radius) * (c - radius) <= radius * radius)
+                disk.at<uchar>(r, c) = 255;
+
+    return disk;
+}
+
+bool Morphology::isDisk(const cv::Mat &kernel, int &radius)
+{
+    if (kernel.rows != kernel.cols || kernel.rows % 2 == 0)
+        return false;
+
+    radius = kernel.rows / 2;
+    for (int r = 0; r < kernel.rows; ++r)
+    {
+        const uchar *pKernel = kernel.ptr<uchar>(r);
+
+        for (int c = 0; c < kernel.cols; ++c)
+        {
+            bool inside = (r - radius) * (r - radius) + (c - radius) * (c - radius) <= radius * radius;
+            if (inside != (pKernel[c] > 0))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// lower envelope of the parabolas (q - p)^2 + g[p]^2 over all p with a finite
+// g[p] (g >= infinity: no target in that column), sampled at q = 0 .. n - 1
+static void distanceRow(const int *g, int n, int infinity, int *output, std::vector<int> &v, std::vector<double> &z)
+{
+    int k = -1;
+
+    for (int q = 0; q < n; ++q)
+    {
+        if (g[q] >= infinity)
+            continue;
+
+        double fq = double(g[q]) * g[q] + double(q) * q;
+        if (k < 0)
+        {
+            k = 0;
+            v[0] = q;
+            z[0] = -DBL_MAX;
+            z[1] = DBL_MAX;
+            continue;
+        }
+
+        // intersection with the rightmost parabola of the envelope
+        double s;
+        while (true)
+        {
+            int p = v[k];
+            s = (fq - (double(g[p]) * g[p] + double(p) * p)) / (2.0 * (q - p));
+            if (s > z[k])
+                break;
+            --k;
+        }
+
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = DBL_MAX;
+    }
+
+    if (k < 0)
+    {
+        for (int q = 0; q < n; ++q)
+            output[q] = INT_MAX;
+        return;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; ++q)
+    {
+        while (z[k + 1] < q)
+            ++k;
+
+        int p = v[k];
+        output[q] = (q - p) * (q - p) + g[p] * g[p];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// separable exact EDT: a forward and a backward scan give the vertical
+// distance g to the nearest target in every column, then every row takes
+// the lower envelope of the parabolas (x - p)^2 + g[p]^2
+////////////////////////////////////////////////////////////////////////////////////
+void Morphology::squaredDistance(const cv::Mat &input, cv::Mat &output, bool toSet)
+{
+    int rows = input.rows;
+    int cols = input.cols;
+    int infinity = rows + 1;
+
+    cv::Mat vertical = temporary(rows, cols, CV_32S);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        const uchar *pInput = input.ptr<uchar>(r);
+        const int *pAbove = r > 0 ? vertical.ptr<int>(r - 1) : 0;
+        int *pVertical = vertical.ptr<int>(r);
+
+        for (int c = 0; c < cols; ++c)
+        {
+            if ((pInput[c] > 0) == toSet)
+                pVertical[c] = 0;
+            else
+                pVertical[c] = pAbove ? std::min(pAbove[c] + 1, infinity) : infinity;
+        }
+    }
+
+    for (int r = rows - 2; r >= 0; --r)
+    {
+        const int *pBelow = vertical.ptr<int>(r + 1);
+        int *pVertical = vertical.ptr<int>(r);
+
+        for (int c = 0; c < cols; ++c)
+            pVertical[c] = std::min(pVertical[c], pBelow[c] + 1);
+    }
+
+    output.create(rows, cols, CV_32S);
+
+    parallel_for(0, rows, [&](int rowBegin, int rowEnd)
+    {
+        std::vector<int> v(cols);
+        std::vector<double> z(cols + 1);
+
+        for (int r = rowBegin; r < rowEnd; ++r)
+            distanceRow(vertical.ptr<int>(r), cols, infinity, output.ptr<int>(r), v, z);
+    }, 16);
+}
+
+void Morphology::distanceTransform(const cv::Mat &input, cv::Mat &output)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    cv::Mat squared = temporary(input.rows, input.cols, CV_32S);
+    squaredDistance(input, squared, false);
+
+    Workspace::prepareOutput(input, output, input.rows, input.cols, CV_32F);
+    for (int r = 0; r < input.rows; ++r)
+    {
+        const int *pSquared = squared.ptr<int>(r);
+        float *pOutput = output.ptr<float>(r);
+
+        for (int c = 0; c < input.cols; ++c)
+            pOutput[c] = pSquared[c] == INT_MAX ? FLT_MAX : sqrtf(float(pSquared[c]));
+    }
+}
+
+void Morphology::dilateDisk(const cv::Mat &input, cv::Mat &output, int radius)
+{
+    if (input.empty() || radius < 0)
+    {
+        std::cout << "Input is empty or radius is negative!" << std::endl;
+        return;
+    }
+
+    dilateErodeDisk(input, output, radius, true);
+}
+
+void Morphology::erodeDisk(const cv::Mat &input, cv::Mat &output, int radius)
+{
+    if (input.empty() || radius < 0)
+    {
+        std::cout << "Input is empty or radius is negative!" << std::endl;
+        return;
+    }
+
+    dilateErodeDisk(input, output, radius, false);
+}
+
+// a written pixel's disk lies completely inside the image, so the distance
+// to the nearest set (zero) pixel decides the dilation (erosion) exactly
+void Morphology::dilateErodeDisk(const cv::Mat &input, cv::Mat &output, int radius, bool dilation)
+{
+    int rows = input.rows;
+    int cols = input.cols;
+    int size = 2 * radius + 1;
+
+    int outRows = std::max(rows - size, 0);
+    int outCols = std::max(cols - size, 0);
+
+    cv::Mat squared = temporary(rows, cols, CV_32S);
+    squaredDistance(input, squared, dilation);
+
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+    Workspace::clearBorder(output, radius, rows - radius - outRows, radius, cols - radius - outCols);
+
+    int limit = radius * radius;
+    for (int r = 0; r < outRows; ++r)
+    {
+        const int *pSquared = squared.ptr<int>(r + radius) + radius;
+        uchar *pOutput = output.ptr<uchar>(r + radius) + radius;
+
+        if (dilation)
+            for (int c = 0; c < outCols; ++c)
+                pOutput[c] = pSquared[c] <= limit ? 255 : 0;
+        else
+            for (int c = 0; c < outCols; ++c)
+                pOutput[c] = pSquared[c] > limit ? 255 : 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Zhang-Suen thinning
+//
+// neighbour code of a pixel: bit 0 .. 7 = N, NE, E, SE, S, SW, W, NW (P2 .. P9);
+// thinningTable[step][code] tells whether the pixel is deleted in sub-iteration
+// step. Only candidates are tested: set pixels with a background neighbour at
+// the start, afterwards the surviving candidates and the set neighbours of
+// deleted pixels. Every sub-iteration decides on the image of the previous
+// one, so the row bands test in parallel and delete after all have decided
+////////////////////////////////////////////////////////////////////////////////////
+static void buildThinningTable(uchar table[2][256])
+{
+    for (int code = 0; code < 256; ++code)
+    {
+        int p[8];
+        int neighbours = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            p[i] = (code >> i) & 1;
+            neighbours += p[i];
+        }
+
+        // number of 0 -> 1 transitions in P2, P3, .., P9, P2
+        int transitions = 0;
+        for (int i = 0; i < 8; ++i)
+            if (p[i] == 0 && p[(i + 1) % 8] == 1)
+                ++transitions;
+
+        bool candidate = neighbours >= 2 && neighbours <= 6 && transitions == 1;
+
+        // P2 = p[0], P4 = p[2], P6 = p[4], P8 = p[6]
+        table[0][code] = candidate && !(p[0] && p[2] && p[4]) && !(p[2] && p[4] && p[6]);
+        table[1][code] = candidate && !(p[0] && p[2] && p[6]) && !(p[0] && p[4] && p[6]);
+    }
+}
+
+static inline int neighbourCode(const uchar *pPixel, int stride)
+{
+    return pPixel[-stride] | (pPixel[-stride + 1] << 1) | (pPixel[1] << 2) | (pPixel[stride + 1] << 3) |
+           (pPixel[stride] << 4) | (pPixel[stride - 1] << 5) | (pPixel[-1] << 6) | (pPixel[-stride - 1] << 7);
+}
+
+void Morphology::thin(const cv::Mat &input, cv::Mat &output)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    int rows = input.rows;
+    int cols = input.cols;
+
+    // 0/1 image with a background border of one pixel: no bounds checks
+    int stride = cols + 2;
+    std::vector<uchar> image((rows + 2) * stride, 0);
+    std::vector<uchar> queued(image.size(), 0);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        const uchar *pInput = input.ptr<uchar>(r);
+        uchar *pImage = &image[(r + 1) * stride + 1];
+
+        for (int c = 0; c < cols; ++c)
+            pImage[c] = pInput[c] > 0 ? 1 : 0;
+    }
+
+    // bands of image rows 1 .. rows (padded coordinates)
+    const int bandRows = 32;
+    int bands = (rows + bandRows - 1) / bandRows;
+    std::vector<std::vector<int> > candidates(bands), deleted(bands);
+
+    auto bandOf = [&](int index)
+    {
+        return (index / stride - 1) / bandRows;
+    };
+
+    parallel_for(0, bands, [&](int bandBegin, int bandEnd)
+    {
+        for (int band = bandBegin; band < bandEnd; ++band)
+        {
+            int rowEnd = std::min((band + 1) * bandRows, rows);
+
+            for (int r = band * bandRows; r < rowEnd; ++r)
+                for (int c = 0; c < cols; ++c)
+                {
+                    int index = (r + 1) * stride + c + 1;
+                    if (image[index] && neighbourCode(&image[index], stride) != 255)
+                        candidates[band].push_back(index);
+                }
+        }
+    });
+
+    // stop after two sub-iterations without deletions
+    int unchanged = 0;
+    for (int step = 0; unchanged < 2; step = 1 - step)
+    {
+        // decide on the current image
+        parallel_for(0, bands, [&](int bandBegin, int bandEnd)
+        {
+            for (int band = bandBegin; band < bandEnd; ++band)
+            {
+                deleted[band].clear();
+                for (size_t i = 0; i < candidates[band].size(); ++i)
+                {
+                    int index = candidates[band][i];
+                    if (thinningTable[step][neighbourCode(&image[index], stride)])
+                        deleted[band].push_back(index);
+                }
+            }
+        });
+
+        size_t deletions = 0;
+        for (int band = 0; band < bands; ++band)
+            deletions += deleted[band].size();
+
+        if (deletions == 0)
+        {
+            ++unchanged;
+            continue;
+        }
+        unchanged = 0;
+
+        // delete, then collect the next candidates of every band
+        parallel_for(0, bands, [&](int bandBegin, int bandEnd)
+        {
+            for (int band = bandBegin; band < bandEnd; ++band)
+                for (size_t i = 0; i < deleted[band].size(); ++i)
+                    image[deleted[band][i]] = 0;
+        });
+
+        parallel_for(0, bands, [&](int bandBegin, int bandEnd)
+        {
+            std::vector<int> next;
+
+            for (int band = bandBegin; band < bandEnd; ++band)
+            {
+                next.clear();
+
+                for (size_t i = 0; i < candidates[band].size(); ++i)
+                {
+                    int index = candidates[band][i];
+                    if (image[index] && !queued[index])
+                    {
+                        queued[index] = 1;
+                        next.push_back(index);
+                    }
+                }
+
+                // deleted pixels of this band and the neighbouring bands
+                for (int other = std::max(band - 1, 0); other <= std::min(band + 1, bands - 1); ++other)
+                {
+                    for (size_t i = 0; i < deleted[other].size(); ++i)
+                    {
+                        int center = deleted[other][i];
+
+                        for (int dr = -1; dr <= 1; ++dr)
+                            for (int dc = -1; dc <= 1; ++dc)
+                            {
+                                int index = center + dr * stride + dc;
+                                int row = index / stride;
+                                if (row < 1 || row > rows || bandOf(index) != band)
+                                    continue;
+
+                                if (image[index] && !queued[index])
+                                {
+                                    queued[index] = 1;
+                                    next.push_back(index);
+                                }
+                            }
+                    }
+                }
+
+                for (size_t i = 0; i < next.size(); ++i)
+                    queued[next[i]] = 0;
+                candidates[band].swap(next);
+            }
+        });
+    }
+
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+    for (int r = 0; r < rows; ++r)
+    {
+        const uchar *pImage = &image[(r + 1) * stride + 1];
+        uchar *pOutput = output.ptr<uchar>(r);
+
+        for (int c = 0; c < cols; ++c)
+            pOutput[c] = pImage[c] ? 255 : 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// hit-or-miss and neighbourhood tables
+//
+// index of a 3x3 neighbourhood: bit 3 * row + col, the center is bit 4; moving
+// one column to the right drops the left column and adds the new one
+////////////////////////////////////////////////////////////////////////////////////
+static const int neighbourBits[8] = { 1, 2, 5, 8, 7, 6, 3, 0 };   // N, NE, E, SE, S, SW, W, NW
+
+// number of set neighbours and of 0 -> 1 transitions around the center; an
+// endpoint has one branch: a single run of at most 3 set neighbours (a spur
+// touching a line at its base has 3 contiguous neighbours)
+static void neighbourhoodCounts(int index, int &neighbours, int &transitions)
+{
+    neighbours = 0;
+    transitions = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        int current = (index >> neighbourBits[i]) & 1;
+        int next = (index >> neighbourBits[(i + 1) % 8]) & 1;
+
+        neighbours += current;
+        if (current == 0 && next == 1)
+            ++transitions;
+    }
+}
+
+template <typename Rule>
+static void buildTable(uchar table[512], Rule rule)
+{
+    for (int index = 0; index < 512; ++index)
+        table[index] = rule(index) ? 255 : 0;
+}
+
+void Morphology::applyTable(const cv::Mat &input, cv::Mat &output, const uchar table[512])
+{
+    int rows = input.rows;
+    int cols = input.cols;
+
+    // every pixel is written below
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+
+    // the rows above and below the image (read only, shared by all threads)
+    cv::Mat zeroRow = temporary(1, cols, CV_8U);
+    const uchar *zero = zeroRow.ptr<uchar>(0);
+    memset(zeroRow.ptr<uchar>(0), 0, cols);
+
+    parallel_for(0, rows, [&](int rowBegin, int rowEnd)
+    {
+        for (int r = rowBegin; r < rowEnd; ++r)
+        {
+            const uchar *pAbove = r > 0 ? input.ptr<uchar>(r - 1) : zero;
+            const uchar *pInput = input.ptr<uchar>(r);
+            const uchar *pBelow = r + 1 < rows ? input.ptr<uchar>(r + 1) : zero;
+            uchar *pOutput = output.ptr<uchar>(r);
+
+            // column 0 as the right column; the first shift moves it to the middle
+            int index = (pAbove[0] > 0 ? 1 << 2 : 0) | (pInput[0] > 0 ? 1 << 5 : 0) | (pBelow[0] > 0 ? 1 << 8 : 0);
+
+            for (int c = 0; c < cols; ++c)
+            {
+                index = (index >> 1) & 0xDB;
+                if (c + 1 < cols)
+                    index |= (pAbove[c + 1] > 0 ? 1 << 2 : 0) | (pInput[c + 1] > 0 ? 1 << 5 : 0) |
+                             (pBelow[c + 1] > 0 ? 1 << 8 : 0);
+
+                pOutput[c] = table[index];
+            }
+        }
+    }, 16);
+}
+
+void Morphology::hitOrMiss(const cv::Mat &input, cv::Mat &output, const std::vector<cv::Mat> &patterns)
+{
+    if (input.empty() || patterns.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    // masks of the bits that must be set (hit) and must be background (miss)
+    std::vector<int> hit(patterns.size(), 0), miss(patterns.size(), 0);
+    for (size_t p = 0; p < patterns.size(); ++p)
+    {
+        if (patterns[p].rows != 3 || patterns[p].cols != 3 || patterns[p].type() != CV_8S)
+        {
+            std::cout << "Patterns must be 3x3 CV_8S!" << std::endl;
+            return;
+        }
+
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 3; ++c)
+            {
+                signed char value = patterns[p].at<signed char>(r, c);
+                if (value > 0)
+                    hit[p] |= 1 << (3 * r + c);
+                else if (value < 0)
+                    miss[p] |= 1 << (3 * r + c);
+            }
+    }
+
+    uchar table[512];
+    buildTable(table, [&](int index)
+    {
+        for (size_t p = 0; p < patterns.size(); ++p)
+            if ((index & hit[p]) == hit[p] && (index & miss[p]) == 0)
+                return true;
+        return false;
+    });
+
+    applyTable(input, output, table);
+}
+
+void Morphology::endpoints(const cv::Mat &input, cv::Mat &output)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    uchar table[512];
+    buildTable(table, [](int index)
+    {
+        int neighbours, transitions;
+        neighbourhoodCounts(index, neighbours, transitions);
+        return (index & (1 << 4)) && transitions == 1 && neighbours <= 3;
+    });
+
+    applyTable(input, output, table);
+}
+
+void Morphology::isolatedPixels(const cv::Mat &input, cv::Mat &output)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    uchar table[512];
+    buildTable(table, [](int index)
+    {
+        return index == (1 << 4);
+    });
+
+    applyTable(input, output, table);
+}
+
+void Morphology::junctions(const cv::Mat &input, cv::Mat &output)
+{
+    if (input.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    uchar table[512];
+    buildTable(table, [](int index)
+    {
+        int neighbours, transitions;
+        neighbourhoodCounts(index, neighbours, transitions);
+        return (index & (1 << 4)) && transitions >= 3;
+    });
+
+    applyTable(input, output, table);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// pruning: length passes remove the current endpoints, then the endpoints of
+// the result grow back length pixels, restricted to the input (conditional
+// dilation), so only the spurs stay removed
+////////////////////////////////////////////////////////////////////////////////////
+void Morphology::prune(const cv::Mat &input, cv::Mat &output, int length)
+{
+    if (input.empty() || length < 0)
+    {
+        std::cout << "Input is empty or length is negative!" << std::endl;
+        return;
+    }
+
+    int rows = input.rows;
+    int cols = input.cols;
+
+    uchar centerTable[512], keepTable[512], endpointTable[512], growTable[512];
+    buildTable(centerTable, [](int index)
+    {
+        return (index & (1 << 4)) != 0;
+    });
+    buildTable(keepTable, [](int index)
+    {
+        int neighbours, transitions;
+        neighbourhoodCounts(index, neighbours, transitions);
+        return (index & (1 << 4)) && !(transitions == 1 && neighbours <= 3);
+    });
+    buildTable(endpointTable, [](int index)
+    {
+        int neighbours, transitions;
+        neighbourhoodCounts(index, neighbours, transitions);
+        return (index & (1 << 4)) && transitions == 1 && neighbours <= 3;
+    });
+    buildTable(growTable, [](int index)
+    {
+        return index != 0;
+    });
+
+    cv::Mat pruned, next;
+    applyTable(input, pruned, length > 0 ? keepTable : centerTable);
+    for (int i = 1; i < length; ++i)
+    {
+        applyTable(pruned, next, keepTable);
+        std::swap(pruned, next);
+    }
+
+    cv::Mat ends;
+    applyTable(pruned, ends, endpointTable);
+    for (int i = 0; i < length; ++i)
+    {
+        applyTable(ends, next, growTable);
+
+        for (int r = 0; r < rows; ++r)
+        {
+            const uchar *pInput = input.ptr<uchar>(r);
+            uchar *pNext = next.ptr<uchar>(r);
+
+            for (int c = 0; c < cols; ++c)
+                if (pInput[c] == 0)
+                    pNext[c] = 0;
+        }
+        std::swap(ends, next);
+    }
+
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+    for (int r = 0; r < rows; ++r)
+    {
+        const uchar *pPruned = pruned.ptr<uchar>(r);
+        const uchar *pEnds = ends.ptr<uchar>(r);
+        uchar *pOutput = output.ptr<uchar>(r);
+
+        for (int c = 0; c < cols; ++c)
+            pOutput[c] = (pPruned[c] | pEnds[c]) ? 255 : 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// morphological reconstruction (L. Vincent, 1993, hybrid algorithm)
+//
+// both images get a border of one pixel with 0 (mask and marker), which never
+// changes and never passes anything on, so the scans need no bounds checks.
+// raster scan: J(p) = min(max(J(p), J of the already scanned neighbours), I(p)),
+// anti-raster scan likewise backwards; pixels that can still raise a later
+// neighbour go into the queue, which propagates until nothing changes
+////////////////////////////////////////////////////////////////////////////////////
+void Morphology::reconstruct(const cv::Mat &marker, const cv::Mat &mask, cv::Mat &output, int connectivity)
+{
+    if (marker.empty() || mask.empty())
+    {
+        std::cout << "One ore more inputs are empty!" << std::endl;
+        return;
+    }
+
+    int rows = mask.rows;
+    int cols = mask.cols;
+
+    if (marker.rows != rows || marker.cols != cols || marker.type() != CV_8U || mask.type() != CV_8U)
+    {
+        std::cout << "marker and mask must be CV_8U images of the same size!" << std::endl;
+        return;
+    }
+
+    if (connectivity != 4 && connectivity != 8)
+    {
+        std::cout << "Connectivity must be 4 or 8!" << std::endl;
+        return;
+    }
+
+    int stride = cols + 2;
+    std::vector<uchar> I((rows + 2) * stride, 0), J(I.size(), 0);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        const uchar *pMarker = marker.ptr<uchar>(r);
+        const uchar *pMask = mask.ptr<uchar>(r);
+        int index = (r + 1) * stride + 1;
+
+        for (int c = 0; c < cols; ++c)
+        {
+            I[index + c] = pMask[c];
+            J[index + c] = std::min(pMarker[c], pMask[c]);
+        }
+    }
+
+    // neighbours scanned before p in raster order; the anti-raster ones are negated
+    const int offsets8[4] = { -stride - 1, -stride, -stride + 1, -1 };
+    const int offsets4[2] = { -stride, -1 };
+    const int *before = connectivity == 8 ? offsets8 : offsets4;
+    int n = connectivity / 2;
+
+    for (int r = 1; r <= rows; ++r)
+    {
+        for (int index = r * stride + 1; index <= r * stride + cols; ++index)
+        {
+            uchar value = J[index];
+            for (int k = 0; k < n; ++k)
+                value = std::max(value, J[index + before[k]]);
+            J[index] = std::min(value, I[index]);
+        }
+    }
+
+    std::vector<int> queue;
+
+    for (int r = rows; r >= 1; --r)
+    {
+        for (int index = r * stride + cols; index >= r * stride + 1; --index)
+        {
+            uchar value = J[index];
+            for (int k = 0; k < n; ++k)
+                value = std::max(value, J[index - before[k]]);
+            value = std::min(value, I[index]);
+            J[index] = value;
+
+            for (int k = 0; k < n; ++k)
+            {
+                int q = index - before[k];
+                if (J[q] < value && J[q] < I[q])
+                {
+                    queue.push_back(index);
+                    break;
+                }
+            }
+        }
+    }
+
+    // FIFO propagation over all neighbours
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        int p = queue[head];
+
+        for (int k = 0; k < 2 * n; ++k)
+        {
+            int q = k < n ? p + before[k] : p - before[k - n];
+
+            if (J[q] < J[p] && I[q] != J[q])
+            {
+                J[q] = std::min(J[p], I[q]);
+                queue.push_back(q);
+            }
+        }
+    }
+
+    // marker and mask are already copied, the output may alias either
+    output.create(rows, cols, CV_8U);
+    for (int r = 0; r < rows; ++r)
+        memcpy(output.ptr<uchar>(r), &J[(r + 1) * stride + 1], cols);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// hole filling: the complement reconstructed from its border pixels is the
+// background reachable from outside; everything else belongs to the objects
+////////////////////////////////////////////////////////////////////////////////////
+void Morphology::fillHoles(const cv::Mat &input, cv::Mat &output)
+{
+    if (input.empty() || input.type() != CV_8U)
+    {
+        std::cout << "Input is empty or not CV_8U!" << std::endl;
+        return;
+    }
+
+    int rows = input.rows;
+    int cols = input.cols;
+
+    cv::Mat complement(rows, cols, CV_8U), marker(rows, cols, CV_8U);
+    for (int r = 0; r < rows; ++r)
+    {
+        const uchar *pInput = input.ptr<uchar>(r);
+        uchar *pComplement = complement.ptr<uchar>(r);
+        uchar *pMarker = marker.ptr<uchar>(r);
+        bool borderRow = r == 0 || r == rows - 1;
+
+        for (int c = 0; c < cols; ++c)
+        {
+            pComplement[c] = 255 - pInput[c];
+            pMarker[c] = (borderRow || c == 0 || c == cols - 1) ? pComplement[c] : 0;
+        }
+    }
+
+    cv::Mat background;
+    reconstruct(marker, complement, background, 4);
+
+    Workspace::prepareOutput(input, output, rows, cols, CV_8U);
+    for (int r = 0; r < rows; ++r)
+    {
+        const uchar *pBackground = background.ptr<uchar>(r);
+        uchar *pOutput = output.ptr<uchar>(r);
+
+        for (int c = 0; c < cols; ++c)
+            pOutput[c] = 255 - pBackground[c];
+    }
+}
+
+void Morphology::removeBorderObjects(const cv::Mat &input, cv::Mat &output)
+{
+    if (input.empty() || input.type() != CV_8U)
+    {
+        std::cout << "Input is empty or not CV_8U!" << std::endl;
+        return;
+    }
+
+    int rows = input.rows;
+    int cols = input.cols;
+
+    cv::Mat marker(rows, cols, CV_8U);
+    for (int r = 0; r < rows; ++r)
+    {
+        const uchar *pInput = input.ptr<uchar>(r);
+        uchar *pMarker = marker.ptr<uchar>(r);
+        bool borderRow = r == 0 || r == rows - 1;
+
+        for (int c = 0; c < cols; ++c)
+            pMarker[c] = (borderRow || c == 0 || c == cols - 1) ? pInput[c] : 0;
+    }
+
+    cv::Mat touching;
+    reconstruct(marker, input, touching);
+    subtract(input, output, touching);
+}
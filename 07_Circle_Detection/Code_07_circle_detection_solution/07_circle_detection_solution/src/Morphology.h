@@ -1,23 +1,163 @@
 #ifndef MORPHOLOGICLAL_H
 #define MORPHOLOGICLAL_H
 
+#include <vector>
+
 #include <opencv2/core/core.hpp>
 
+#include "Workspace.h"
+
+// implementation behind dilate and erode (all give the same results)
+enum class MorphologyEngine
+{
+    Default,   // running min/max for full rectangular kernels, direct otherwise
+    BitPacked  // 64 pixels per word, shifted AND/OR per kernel element
+};
+
 class Morphology
 {
 public:
     Morphology();
     ~Morphology();
 
+    // same as Filter::setWorkspace
+    void setWorkspace(Workspace *workspace);
+
     void dilate(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
     void erode(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
     void subtract(const cv::Mat &input, cv::Mat &output, const cv::Mat &subtract);
 
+    // fused operators: one streaming pass over a small row window, same results as
+    //   boundary: subtract(input, erode(input))     gradient: subtract(dilate, erode)
+    //   open:     dilate(erode(input))              close:    erode(dilate(input))
+    // full rectangles beyond 3x3 and disks (O(1) dilate/erode) run the two
+    // passes instead, with the intermediate taken from the workspace
+    void boundary(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void gradient(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void open(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void close(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+
+    // grayscale (CV_8U): max/min of the input values under the kernel, no
+    // thresholding; pixels outside the image are ignored and every output
+    // pixel is written (same window as dilate/erode)
+    void dilateGray(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void erodeGray(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+
+    // top-hat: input - grayscale opening, black-hat: grayscale closing - input
+    void topHat(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void blackHat(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+
+    void setEngine(MorphologyEngine engine);
+
     cv::Mat getKernelPlus();
     cv::Mat getKernelLine();
     cv::Mat getKernelFull(int size);
 
+    // (2 * radius + 1) square octagon: chain of 3x3 full and plus kernels
+    cv::Mat getKernelOctagon(int radius);
+
+    // (2 * radius + 1) square disk: every element with dx^2 + dy^2 <= radius^2
+    cv::Mat getKernelDisk(int radius);
+
+    // exact Euclidean distance (CV_32F) of every pixel to the nearest zero
+    // pixel; FLT_MAX if the image has no zero pixel
+    void distanceTransform(const cv::Mat &input, cv::Mat &output);
+
+    // same results as dilate/erode with getKernelDisk(radius), but O(1) per
+    // pixel at any radius (threshold on the squared distance map);
+    // dilate/erode use them for disk kernels
+    void dilateDisk(const cv::Mat &input, cv::Mat &output, int radius);
+    void erodeDisk(const cv::Mat &input, cv::Mat &output, int radius);
+
+    // Zhang-Suen thinning to a one pixel wide 8-connected skeleton (0/255)
+    void thin(const cv::Mat &input, cv::Mat &output);
+
+    // 3x3 hit-or-miss: patterns are 3x3 CV_8S with 1 (set), -1 (background)
+    // and 0 (don't care); a pixel is 255 if any pattern matches. Every
+    // neighbourhood is packed into a 9-bit index (bit 3 * row + col) for a
+    // lookup in a 512-entry table; pixels outside the image are background
+    void hitOrMiss(const cv::Mat &input, cv::Mat &output, const std::vector<cv::Mat> &patterns);
+
+    // set pixels with one branch (a single run of at most 3 set neighbours),
+    // with no set neighbour and with three or more branches (0 -> 1
+    // transitions around the pixel)
+    void endpoints(const cv::Mat &input, cv::Mat &output);
+    void isolatedPixels(const cv::Mat &input, cv::Mat &output);
+    void junctions(const cv::Mat &input, cv::Mat &output);
+
+    // removes spurs up to length pixels from a skeleton; the ends of the
+    // remaining branches are grown back inside the input
+    void prune(const cv::Mat &input, cv::Mat &output, int length);
+
+    // reconstruction by dilation (CV_8U, binary or grayscale): marker dilated
+    // under mask until stable, with Vincent's hybrid algorithm (raster and
+    // anti-raster scan, then a FIFO queue); connectivity 4 or 8
+    void reconstruct(const cv::Mat &marker, const cv::Mat &mask, cv::Mat &output, int connectivity = 8);
+
+    // fills regions not reachable from the image border (4-connected
+    // background), removes 8-connected objects touching the border
+    void fillHoles(const cv::Mat &input, cv::Mat &output);
+    void removeBorderObjects(const cv::Mat &input, cv::Mat &output);
+
 private:
+    Workspace *workspace;
+
+    cv::Mat temporary(int rows, int cols, int type);
+
+    // full rectangular kernels (every element set) use the van Herk/Gil-Werman
+    // running min/max, all others the direct implementation
+    bool isFullRect(const cv::Mat &kernel);
+    void dilateDirect(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void erodeDirect(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel);
+    void dilateErodeRect(const cv::Mat &input, cv::Mat &output, int kRows, int kCols, bool dilation);
+    void dilateErodeBitPacked(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel, bool dilation);
+
+    // Felzenszwalb-Huttenlocher: squared distance (CV_32S) to the nearest set
+    // pixel (toSet) or zero pixel; INT_MAX if there is none
+    void squaredDistance(const cv::Mat &input, cv::Mat &output, bool toSet);
+    bool isDisk(const cv::Mat &kernel, int &radius);
+    void dilateErodeDisk(const cv::Mat &input, cv::Mat &output, int radius, bool dilation);
+
+    // a kernel as a union of parts; every part is a chain of smaller kernels
+    // (their Minkowski sum) whose top left corner is at (offsetRow, offsetCol)
+    struct KernelPart
+    {
+        int offsetRow, offsetCol;
+        std::vector<cv::Mat> chain;
+    };
+    struct Decomposition
+    {
+        cv::Mat kernel;                  // copy of the analyzed kernel
+        std::vector<KernelPart> parts;   // empty: no cheaper decomposition
+    };
+    std::vector<Decomposition> decompositionCache;
+
+    const Decomposition &decompose(const cv::Mat &kernel);
+    void dilateErodeDecomposed(const cv::Mat &input, cv::Mat &output, int kRows, int kCols,
+                               const std::vector<KernelPart> &parts, bool dilation);
+
+    // the fused operators run separate dilate/erode passes for these kernels
+    bool hasFastEngine(const cv::Mat &kernel);
+    void boundaryGradient(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel, bool gradient);
+    void openClose(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel, bool closing);
+
+    // offsets of the kernel elements relative to the output pixel; reflected
+    // offsets undo the window shift (second step of opening and closing)
+    void grayOffsets(const cv::Mat &kernel, bool reflected, std::vector<cv::Point> &offsets);
+    void grayExtreme(const cv::Mat &input, cv::Mat &output, const std::vector<cv::Point> &sorted, bool dilation);
+
+    // kernel elements / offsets and the row pointers of the fused and grayscale
+    // operators, kept so that repeated calls do not allocate
+    std::vector<cv::Point> kernelOffsets, reflectedOffsets;
+    std::vector<const uchar *> rowPointers;
+
+    MorphologyEngine engine;
+
+    // Zhang-Suen deletion decision per sub-iteration and neighbour code
+    uchar thinningTable[2][256];
+
+    void applyTable(const cv::Mat &input, cv::Mat &output, const uchar table[512]);
+
     cv::Mat kernel3x3Plus;
     cv::Mat kernel1x5Line;
     cv::Mat kernel3x3Full, kernel4x4Full;
@@ -0,0 +1,188 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// persistent worker threads (one per hardware thread, the calling thread
+// included), created on first use and reused by every parallel_for; run()
+// executes task(0) .. task(tasks - 1) and returns when all are done. Calls
+// from inside a task run serially, so nested loops cannot deadlock
+///////////////////////////////////////////////////////////////////////////////
+class ThreadPool
+{
+public:
+    static ThreadPool &instance()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    int getThreads() const
+    {
+        return int(workers.size()) + 1;
+    }
+
+    void run(int tasks, const std::function<void(int)> &task)
+    {
+        if (tasks <= 0)
+            return;
+
+        if (tasks == 1 || workers.empty() || insideTask())
+        {
+            for (int i = 0; i < tasks; ++i)
+                task(i);
+            return;
+        }
+
+        // one loop at a time (calls from several outside threads)
+        std::lock_guard<std::mutex> serial(runMutex);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &task;
+            nextTask = 0;
+            taskCount = tasks;
+            pending = tasks;
+            ++generation;
+        }
+        wake.notify_all();
+
+        // the calling thread works as well
+        work();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+        job = 0;
+    }
+
+private:
+    ThreadPool()
+        : job(0), nextTask(0), taskCount(0), pending(0), generation(0), stop(false)
+    {
+        int threads = int(std::thread::hardware_concurrency());
+        for (int t = 1; t < threads; ++t)
+            workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+
+        for (size_t t = 0; t < workers.size(); ++t)
+            workers[t].join();
+    }
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+    static bool &insideTask()
+    {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    // take tasks of the current job until none is left
+    void work()
+    {
+        bool wasInside = insideTask();
+        insideTask() = true;
+
+        while (true)
+        {
+            int i;
+            const std::function<void(int)> *task;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (nextTask >= taskCount)
+                    break;
+                i = nextTask++;
+                task = job;
+            }
+
+            (*task)(i);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0)
+                done.notify_all();
+        }
+
+        insideTask() = wasInside;
+    }
+
+    void workerLoop()
+    {
+        unsigned long seen = 0;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stop || generation != seen; });
+                if (stop)
+                    return;
+                seen = generation;
+            }
+
+            work();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex runMutex, mutex;
+    std::condition_variable wake, done;
+
+    const std::function<void(int)> *job;
+    int nextTask, taskCount, pending;
+    unsigned long generation;
+    bool stop;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// split [begin, end) into one contiguous range per pool thread and call
+// body(rangeBegin, rangeEnd) for every range in parallel; ranges smaller than
+// minRange are not split any further. The task handed to the pool only holds
+// a reference, so std::function keeps it in place and no call allocates
+///////////////////////////////////////////////////////////////////////////////
+template <typename Body>
+inline void parallel_for(int begin, int end, const Body &body, int minRange = 1)
+{
+    int count = end - begin;
+    if (count <= 0)
+        return;
+
+    ThreadPool &pool = ThreadPool::instance();
+    int threads = pool.getThreads();
+    threads = std::max(1, std::min(threads, (count + minRange - 1) / std::max(minRange, 1)));
+
+    if (threads == 1)
+    {
+        body(begin, end);
+        return;
+    }
+
+    struct Split
+    {
+        int begin, end, chunk;
+        const Body *body;
+    } split = { begin, end, (count + threads - 1) / threads, &body };
+
+    int ranges = (count + split.chunk - 1) / split.chunk;
+
+    pool.run(ranges, [&split](int t)
+    {
+        int rangeBegin = split.begin + t * split.chunk;
+        (*split.body)(rangeBegin, std::min(split.end, rangeBegin + split.chunk));
+    });
+}
+
+#endif /* PARALLEL_H */
@@ -18,10 +18,9 @@ void PointOperations::adjustContrast(cv::Mat &input, cv::Mat &output, float alph
     int rows = input.rows;
     int cols = input.cols;
 
-    output.release();
     output.create(rows, cols, CV_8U);
 
-    if (input.isContinuous())
+    if (input.isContinuous() && output.isContinuous())
     {
         cols = rows * cols;
         rows = 1;
@@ -60,10 +59,9 @@ void PointOperations::adjustBrightness(cv::Mat &input, cv::Mat &output, int alph
     int rows = input.rows;
     int cols = input.cols;
 
-    output.release();
     output.create(rows, cols, CV_8U);
 
-    if (input.isContinuous())
+    if (input.isContinuous() && output.isContinuous())
     {
         cols = rows * cols;
         rows = 1;
@@ -102,10 +100,9 @@ void PointOperations::invert(cv::Mat &input, cv::Mat &output)
     int rows = input.rows;
     int cols = input.cols;
 
-    output.release();
     output.create(rows, cols, CV_8U);
 
-    if (input.isContinuous())
+    if (input.isContinuous() && output.isContinuous())
     {
         cols = rows * cols;
         rows = 1;
@@ -135,10 +132,9 @@ void PointOperations::quantize(cv::Mat &input, cv::Mat &output, uchar n)
     int rows = input.rows;
     int cols = input.cols;
 
-    output.release();
     output.create(rows, cols, CV_8U);
 
-    if (input.isContinuous())
+    if (input.isContinuous() && output.isContinuous())
     {
         cols = rows * cols;
         rows = 1;
@@ -0,0 +1,352 @@
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+
+#include "RunLengthImage.h"
+
+RunLengthImage::RunLengthImage()
+    : rows(0), cols(0)
+{}
+
+RunLengthImage::~RunLengthImage()
+{}
+
+int RunLengthImage::getRows() const
+{
+    return rows;
+}
+
+int RunLengthImage::getCols() const
+{
+    return cols;
+}
+
+const std::vector<Run> &RunLengthImage::getRuns() const
+{
+    return runs;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// conversion from and to cv::Mat
+////////////////////////////////////////////////////////////////////////////////////
+void RunLengthImage::fromMat(const cv::Mat &input)
+{
+    if (input.empty() || input.type() != CV_8U)
+    {
+        std::cout << "Input is empty or not CV_8U!" << std::endl;
+        return;
+    }
+
+    setSize(input.rows, input.cols);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        const uchar *pInput = input.ptr<uchar>(r);
+        int c = 0;
+
+        while (c < cols)
+        {
+            // skip the empty space
+            while (c < cols && pInput[c] == 0)
+                ++c;
+            if (c == cols)
+                break;
+
+            Run run;
+            run.row = r;
+            run.begin = c;
+            while (c < cols && pInput[c] > 0)
+                ++c;
+            run.end = c;
+
+            runs.push_back(run);
+        }
+
+        rowStart[r + 1] = int(runs.size());
+    }
+}
+
+void RunLengthImage::toMat(cv::Mat &output) const
+{
+    output.create(rows, cols, CV_8U);
+    output.setTo(cv::Scalar(0));
+
+    for (size_t i = 0; i < runs.size(); ++i)
+        memset(output.ptr<uchar>(runs[i].row) + runs[i].begin, 255, runs[i].end - runs[i].begin);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// helpers: interval lists [first, second) of one row
+////////////////////////////////////////////////////////////////////////////////////
+void RunLengthImage::setSize(int rows, int cols)
+{
+    this->rows = rows;
+    this->cols = cols;
+    runs.clear();
+    rowStart.assign(rows + 1, 0);
+}
+
+void RunLengthImage::rowIntervals(int row, Intervals &intervals) const
+{
+    intervals.clear();
+    for (int i = rowStart[row]; i < rowStart[row + 1]; ++i)
+        intervals.push_back(std::make_pair(runs[i].begin, runs[i].end));
+}
+
+// append the intervals of the next row (rows must be appended in order);
+// rowStart is valid after buildRowStart
+void RunLengthImage::appendRow(int row, const Intervals &intervals)
+{
+    for (size_t i = 0; i < intervals.size(); ++i)
+    {
+        Run run = { row, intervals[i].first, intervals[i].second };
+        runs.push_back(run);
+    }
+}
+
+// row index of the runs, in one pass after the last appendRow
+void RunLengthImage::buildRowStart()
+{
+    size_t i = 0;
+    for (int r = 0; r < rows; ++r)
+    {
+        rowStart[r] = int(i);
+        while (i < runs.size() && runs[i].row == r)
+            ++i;
+    }
+    rowStart[rows] = int(runs.size());
+}
+
+// sort, clip to [low, high) and merge overlapping or touching intervals
+static void normalize(std::vector<std::pair<int, int> > &intervals, int low, int high)
+{
+    std::sort(intervals.begin(), intervals.end());
+
+    size_t n = 0;
+    for (size_t i = 0; i < intervals.size(); ++i)
+    {
+        int begin = std::max(intervals[i].first, low);
+        int end = std::min(intervals[i].second, high);
+        if (begin >= end)
+            continue;
+
+        if (n > 0 && begin <= intervals[n - 1].second)
+            intervals[n - 1].second = std::max(intervals[n - 1].second, end);
+        else
+            intervals[n++] = std::make_pair(begin, end);
+    }
+    intervals.resize(n);
+}
+
+// a AND b for sorted, disjoint interval lists
+static void intersect(const std::vector<std::pair<int, int> > &a, const std::vector<std::pair<int, int> > &b,
+                      std::vector<std::pair<int, int> > &result)
+{
+    result.clear();
+    size_t i = 0, j = 0;
+
+    while (i < a.size() && j < b.size())
+    {
+        int begin = std::max(a[i].first, b[j].first);
+        int end = std::min(a[i].second, b[j].second);
+        if (begin < end)
+            result.push_back(std::make_pair(begin, end));
+
+        if (a[i].second < b[j].second)
+            ++i;
+        else
+            ++j;
+    }
+}
+
+// the runs of every kernel row: [first, second] columns (inclusive)
+static void kernelRowRuns(const cv::Mat &kernel, int kr, std::vector<std::pair<int, int> > &kernelRuns)
+{
+    kernelRuns.clear();
+    const uchar *pKernel = kernel.ptr<uchar>(kr);
+
+    for (int kc = 0; kc < kernel.cols; ++kc)
+    {
+        if (pKernel[kc] == 0)
+            continue;
+
+        if (!kernelRuns.empty() && kernelRuns.back().second == kc - 1)
+            kernelRuns.back().second = kc;
+        else
+            kernelRuns.push_back(std::make_pair(kc, kc));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// dilation: an input run [s, e) and a kernel row run [a, b] give the output
+// columns [s - b, e - a) (plus the reference point), so the cost depends on
+// the number of runs, not on the number of pixels
+////////////////////////////////////////////////////////////////////////////////////
+void RunLengthImage::dilate(RunLengthImage &output, const cv::Mat &kernel) const
+{
+    if (kernel.empty() || kernel.type() != CV_8U)
+    {
+        std::cout << "Kernel is empty or not CV_8U!" << std::endl;
+        return;
+    }
+
+    int kRows = kernel.rows;
+    int kCols = kernel.cols;
+    int refPointX = (kCols - 1) / 2;
+    int refPointY = (kRows - 1) / 2;
+
+    // written area of Morphology::dilate
+    int outRows = std::max(rows - kRows, 0);
+    int outCols = std::max(cols - kCols, 0);
+
+    std::vector<Intervals> kernelRuns(kRows);
+    for (int kr = 0; kr < kRows; ++kr)
+        kernelRowRuns(kernel, kr, kernelRuns[kr]);
+
+    RunLengthImage result;
+    result.setSize(rows, cols);
+    Intervals intervals;
+
+    for (int r = 0; r < outRows; ++r)
+    {
+        intervals.clear();
+
+        for (int kr = 0; kr < kRows; ++kr)
+        {
+            int inputRow = r + kr;
+
+            for (int i = rowStart[inputRow]; i < rowStart[inputRow + 1]; ++i)
+            {
+                for (size_t k = 0; k < kernelRuns[kr].size(); ++k)
+                {
+                    intervals.push_back(std::make_pair(runs[i].begin - kernelRuns[kr][k].second + refPointX,
+                                                       runs[i].end - kernelRuns[kr][k].first + refPointX));
+                }
+            }
+        }
+
+        normalize(intervals, refPointX, refPointX + outCols);
+        result.appendRow(r + refPointY, intervals);
+    }
+
+    result.buildRowStart();
+    output = result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// erosion: a window position survives if every kernel row run [a, b] fits
+// into an input run [s, e) of its row, i.e. [s - a, e - b); the results of
+// all kernel row runs are intersected
+////////////////////////////////////////////////////////////////////////////////////
+void RunLengthImage::erode(RunLengthImage &output, const cv::Mat &kernel) const
+{
+    if (kernel.empty() || kernel.type() != CV_8U)
+    {
+        std::cout << "Kernel is empty or not CV_8U!" << std::endl;
+        return;
+    }
+
+    int kRows = kernel.rows;
+    int kCols = kernel.cols;
+    int refPointX = (kCols - 1) / 2;
+    int refPointY = (kRows - 1) / 2;
+
+    int outRows = std::max(rows - kRows, 0);
+    int outCols = std::max(cols - kCols, 0);
+
+    std::vector<Intervals> kernelRuns(kRows);
+    for (int kr = 0; kr < kRows; ++kr)
+        kernelRowRuns(kernel, kr, kernelRuns[kr]);
+
+    RunLengthImage result;
+    result.setSize(rows, cols);
+    Intervals intervals, fitting, intersection;
+
+    for (int r = 0; r < outRows; ++r)
+    {
+        // start with the whole written row
+        intervals.assign(1, std::make_pair(0, outCols));
+
+        for (int kr = 0; kr < kRows && !intervals.empty(); ++kr)
+        {
+            int inputRow = r + kr;
+
+            for (size_t k = 0; k < kernelRuns[kr].size() && !intervals.empty(); ++k)
+            {
+                fitting.clear();
+                for (int i = rowStart[inputRow]; i < rowStart[inputRow + 1]; ++i)
+                {
+                    int begin = runs[i].begin - kernelRuns[kr][k].first;
+                    int end = runs[i].end - kernelRuns[kr][k].second;
+                    if (begin < end)
+                        fitting.push_back(std::make_pair(begin, end));
+                }
+
+                intersect(intervals, fitting, intersection);
+                intervals.swap(intersection);
+            }
+        }
+
+        for (size_t i = 0; i < intervals.size(); ++i)
+        {
+            intervals[i].first += refPointX;
+            intervals[i].second += refPointX;
+        }
+
+        result.appendRow(r + refPointY, intervals);
+    }
+
+    result.buildRowStart();
+    output = result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// subtraction of binary images: set in this image and not set in subtract
+////////////////////////////////////////////////////////////////////////////////////
+void RunLengthImage::subtract(RunLengthImage &output, const RunLengthImage &subtract) const
+{
+    if (subtract.rows != rows || subtract.cols != cols)
+    {
+        std::cout << "subtract image does not fit input image!" << std::endl;
+        return;
+    }
+
+    RunLengthImage result;
+    result.setSize(rows, cols);
+    Intervals a, b, difference;
+
+    for (int r = 0; r < rows; ++r)
+    {
+        rowIntervals(r, a);
+        subtract.rowIntervals(r, b);
+        difference.clear();
+
+        size_t j = 0;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            int begin = a[i].first;
+            int end = a[i].second;
+
+            // skip the subtracted runs left of this run
+            while (j < b.size() && b[j].second <= begin)
+                ++j;
+
+            size_t k = j;
+            while (k < b.size() && b[k].first < end)
+            {
+                if (b[k].first > begin)
+                    difference.push_back(std::make_pair(begin, b[k].first));
+                begin = std::max(begin, b[k].second);
+                ++k;
+            }
+
+            if (begin < end)
+                difference.push_back(std::make_pair(begin, end));
+        }
+
+        result.appendRow(r, difference);
+    }
+
+    result.buildRowStart();
+    output = result;
+}
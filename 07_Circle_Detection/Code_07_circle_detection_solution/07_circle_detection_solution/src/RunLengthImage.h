@@ -0,0 +1,52 @@
+#ifndef RUNLENGTHIMAGE_H
+#define RUNLENGTHIMAGE_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+// horizontal run of set pixels: columns begin .. end - 1 of one row
+struct Run
+{
+    int row;
+    int begin;
+    int end;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// run-length encoded binary image for sparse images (edge maps, text scans);
+// dilate, erode and subtract work on the runs and give the same results as
+// the Morphology functions (reference point, written area and zero border)
+////////////////////////////////////////////////////////////////////////////////////
+class RunLengthImage
+{
+public:
+    RunLengthImage();
+    ~RunLengthImage();
+
+    // pixels > 0 are set; toMat writes 0/255
+    void fromMat(const cv::Mat &input);
+    void toMat(cv::Mat &output) const;
+
+    int getRows() const;
+    int getCols() const;
+    const std::vector<Run> &getRuns() const;
+
+    void dilate(RunLengthImage &output, const cv::Mat &kernel) const;
+    void erode(RunLengthImage &output, const cv::Mat &kernel) const;
+    void subtract(RunLengthImage &output, const RunLengthImage &subtract) const;
+
+private:
+    typedef std::vector<std::pair<int, int> > Intervals;
+
+    int rows, cols;
+    std::vector<Run> runs;       // sorted by row and column
+    std::vector<int> rowStart;   // runs of row r: rowStart[r] .. rowStart[r + 1] - 1
+
+    void rowIntervals(int row, Intervals &intervals) const;
+    void setSize(int rows, int cols);
+    void appendRow(int row, const Intervals &intervals);
+    void buildRowStart();
+};
+
+#endif /* RUNLENGTHIMAGE_H */
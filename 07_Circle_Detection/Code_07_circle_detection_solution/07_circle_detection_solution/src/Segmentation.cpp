@@ -1,11 +1,14 @@
 #include <iostream>
 #include <math.h>
+#include <algorithm>
+#include <vector>
 
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
 #include "Segmentation.h"
 #include "Filter.h"
+#include "Parallel.h"
 
 ////////////////////////////////////////////////////////////////////////////////////
 // constructor and destructor
@@ -98,9 +101,10 @@ void Segmentation::houghCircle(const cv::Mat &input, cv::Mat &output,
     float scaleFloat = 1.0f / cellStep;
     int scaleInt = round(scaleFloat);
 
-    // create accumulator
-    output.release();
-    output = cv::Mat::zeros(dimB, dimA, CV_32S); // 32 bit integer
+    // create accumulator (the buffer of the last call is reused if it has the
+    // same size)
+    output.create(dimB, dimA, CV_32S); // 32 bit integer
+    output.setTo(0);
 
     // phi deg->rad
     const float phiRadStart = 0.0f;
@@ -256,3 +260,259 @@ void Segmentation::addFoundCenter(std::vector<CircleItem> *list, const int x, co
     newItem.v = value;
     list->push_back(newItem);
 }
+
+////////////////////////////////////////////////////////////////////////////////////
+// Connected component labeling
+//
+// the image is scanned in 2x2 blocks: all set pixels of a block are
+// 8-connected, so a block needs one provisional label and the neighbour blocks
+// (left, top left, top, top right) are connected if the pixels facing each
+// other are set. Block bits: 1 = top left, 2 = top right, 4 = bottom left,
+// 8 = bottom right pixel.
+// pass 1 labels parallel stripes of block rows with disjoint label ranges
+// (union-find, the smaller label is the root), the stripe borders are merged
+// afterwards; pass 2 writes the final labels and accumulates the statistics
+////////////////////////////////////////////////////////////////////////////////////
+static inline int findRoot(std::vector<int> &parent, int label)
+{
+    while (parent[label] != label)
+    {
+        parent[label] = parent[parent[label]];
+        label = parent[label];
+    }
+    return label;
+}
+
+static inline int unite(std::vector<int> &parent, int a, int b)
+{
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+
+    if (a < b)
+        parent[b] = a;
+    else
+        parent[a] = b;
+    return std::min(a, b);
+}
+
+// label of block (br, bc) from its neighbours in the block row above and to
+// the left; 0 if none is connected
+static int connectBlock(std::vector<int> &parent, const std::vector<uchar> &masks, const std::vector<int> &blockLabels,
+                        int blockCols, int br, int bc, bool useAbove)
+{
+    int index = br * blockCols + bc;
+    uchar x = masks[index];
+    int label = 0;
+
+    auto connect = [&](int neighbour)
+    {
+        int other = blockLabels[neighbour];
+        label = label == 0 ? findRoot(parent, other) : unite(parent, label, other);
+    };
+
+    if (useAbove && br > 0)
+    {
+        int above = index - blockCols;
+
+        if ((masks[above] & (4 | 8)) && (x & (1 | 2)))
+            connect(above);
+        if (bc > 0 && (masks[above - 1] & 8) && (x & 1))
+            connect(above - 1);
+        if (bc + 1 < blockCols && (masks[above + 1] & 4) && (x & 2))
+            connect(above + 1);
+    }
+
+    if (bc > 0 && (masks[index - 1] & (2 | 8)) && (x & (1 | 4)))
+        connect(index - 1);
+
+    return label;
+}
+
+int Segmentation::labelComponents(const cv::Mat &input, cv::Mat &labels, std::vector<BlobItem> *blobs)
+{
+    if (input.empty() || input.type() != CV_8U)
+    {
+        std::cout << "Input is empty or not CV_8U!" << std::endl;
+        return 0;
+    }
+
+    int rows = input.rows;
+    int cols = input.cols;
+    int blockRows = (rows + 1) / 2;
+    int blockCols = (cols + 1) / 2;
+
+    std::vector<uchar> masks(blockRows * blockCols);
+    std::vector<int> blockLabels(blockRows * blockCols);
+    std::vector<int> parent(blockRows * blockCols + 1);
+    std::vector<uchar> stripeStart(blockRows, 0);
+
+    // pass 1: provisional labels per stripe; labels of stripe [b0, b1) are
+    // b0 * blockCols + 1 .. b1 * blockCols, so stripes never share entries
+    parallel_for(0, blockRows, [&](int rowBegin, int rowEnd)
+    {
+        stripeStart[rowBegin] = 1;
+        int nextLabel = rowBegin * blockCols + 1;
+
+        for (int br = rowBegin; br < rowEnd; ++br)
+        {
+            const uchar *pTop = input.ptr<uchar>(2 * br);
+            const uchar *pBottom = 2 * br + 1 < rows ? input.ptr<uchar>(2 * br + 1) : 0;
+
+            for (int bc = 0; bc < blockCols; ++bc)
+            {
+                int c = 2 * bc;
+                uchar mask = pTop[c] > 0 ? 1 : 0;
+                if (c + 1 < cols && pTop[c + 1] > 0)
+                    mask |= 2;
+                if (pBottom && pBottom[c] > 0)
+                    mask |= 4;
+                if (pBottom && c + 1 < cols && pBottom[c + 1] > 0)
+                    mask |= 8;
+
+                int index = br * blockCols + bc;
+                masks[index] = mask;
+
+                if (mask == 0)
+                {
+                    blockLabels[index] = 0;
+                    continue;
+                }
+
+                int label = connectBlock(parent, masks, blockLabels, blockCols, br, bc, br > rowBegin);
+                if (label == 0)
+                {
+                    label = nextLabel++;
+                    parent[label] = label;
+                }
+                blockLabels[index] = label;
+            }
+        }
+    }, 8);
+
+    // merge the first block row of every stripe with the row above
+    for (int br = 1; br < blockRows; ++br)
+    {
+        if (!stripeStart[br])
+            continue;
+
+        for (int bc = 0; bc < blockCols; ++bc)
+        {
+            int index = br * blockCols + bc;
+            if (masks[index] == 0)
+                continue;
+
+            int label = connectBlock(parent, masks, blockLabels, blockCols, br, bc, true);
+            if (label != 0)
+                unite(parent, label, blockLabels[index]);
+        }
+    }
+
+    // final labels 1 .. n in scan order; the root is the first block of a blob
+    int count = 0;
+    std::vector<int> finalLabel(parent.size(), 0);
+    for (size_t i = 0; i < blockLabels.size(); ++i)
+    {
+        if (blockLabels[i] == 0)
+            continue;
+
+        int root = findRoot(parent, blockLabels[i]);
+        if (finalLabel[root] == 0)
+            finalLabel[root] = ++count;
+        blockLabels[i] = finalLabel[root];
+    }
+
+    struct Accumulator
+    {
+        int area, perimeter;
+        int minX, minY, maxX, maxY;
+        double sumX, sumY;
+    };
+    std::vector<std::vector<Accumulator> > stripeStats(blockRows);
+
+    labels.create(rows, cols, CV_32S);
+
+    // pass 2: label image and statistics of every stripe
+    parallel_for(0, blockRows, [&](int rowBegin, int rowEnd)
+    {
+        std::vector<Accumulator> &stats = stripeStats[rowBegin];
+        if (blobs)
+        {
+            Accumulator empty = { 0, 0, cols, rows, -1, -1, 0.0, 0.0 };
+            stats.assign(count + 1, empty);
+        }
+
+        for (int r = 2 * rowBegin; r < std::min(2 * rowEnd, rows); ++r)
+        {
+            const uchar *pInput = input.ptr<uchar>(r);
+            const uchar *pAbove = r > 0 ? input.ptr<uchar>(r - 1) : 0;
+            const uchar *pBelow = r + 1 < rows ? input.ptr<uchar>(r + 1) : 0;
+            const int *pBlock = &blockLabels[(r / 2) * blockCols];
+            int *pLabels = labels.ptr<int>(r);
+
+            for (int c = 0; c < cols; ++c)
+            {
+                if (pInput[c] == 0)
+                {
+                    pLabels[c] = 0;
+                    continue;
+                }
+
+                int label = pBlock[c / 2];
+                pLabels[c] = label;
+
+                if (!blobs)
+                    continue;
+
+                Accumulator &a = stats[label];
+                ++a.area;
+                a.sumX += c;
+                a.sumY += r;
+                a.minX = std::min(a.minX, c);
+                a.maxX = std::max(a.maxX, c);
+                a.minY = std::min(a.minY, r);
+                a.maxY = std::max(a.maxY, r);
+
+                if (!pAbove || !pBelow || c == 0 || c == cols - 1 ||
+                    pAbove[c] == 0 || pBelow[c] == 0 || pInput[c - 1] == 0 || pInput[c + 1] == 0)
+                    ++a.perimeter;
+            }
+        }
+    }, 8);
+
+    if (!blobs)
+        return count;
+
+    // merge the stripe statistics
+    blobs->clear();
+    for (int label = 1; label <= count; ++label)
+    {
+        Accumulator total = { 0, 0, cols, rows, -1, -1, 0.0, 0.0 };
+
+        for (int br = 0; br < blockRows; ++br)
+        {
+            if (stripeStats[br].empty())
+                continue;
+
+            const Accumulator &a = stripeStats[br][label];
+            total.area += a.area;
+            total.perimeter += a.perimeter;
+            total.sumX += a.sumX;
+            total.sumY += a.sumY;
+            total.minX = std::min(total.minX, a.minX);
+            total.minY = std::min(total.minY, a.minY);
+            total.maxX = std::max(total.maxX, a.maxX);
+            total.maxY = std::max(total.maxY, a.maxY);
+        }
+
+        BlobItem blob;
+        blob.label = label;
+        blob.area = total.area;
+        blob.box = cv::Rect(total.minX, total.minY, total.maxX - total.minX + 1, total.maxY - total.minY + 1);
+        blob.x = float(total.sumX / total.area);
+        blob.y = float(total.sumY / total.area);
+        blob.perimeter = total.perimeter;
+        blobs->push_back(blob);
+    }
+
+    return count;
+}
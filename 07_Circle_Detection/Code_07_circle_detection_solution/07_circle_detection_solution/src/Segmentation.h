@@ -16,6 +16,23 @@ struct CircleItem
     int v;
 };
 
+struct BlobItem
+{
+    // label in the label image (1 .. number of blobs)
+    int label;
+
+    // number of pixels and bounding box
+    int area;
+    cv::Rect box;
+
+    // centroid
+    float x;
+    float y;
+
+    // number of pixels with a background 4-neighbour (or on the image border)
+    int perimeter;
+};
+
 class Segmentation
 {
 public:
@@ -41,6 +58,11 @@ public:
                      const int radiusMax, const float cellStep,
                      const float phiStep);
 
+    // Connected Components (8-connectivity): labels (CV_32S) is 0 for the
+    // background and 1 .. n for the blobs, numbered in the scan order of
+    // their first 2x2 block; returns n
+    int labelComponents(const cv::Mat &input, cv::Mat &labels, std::vector<BlobItem> *blobs);
+
   private:
       void addFoundCenter(std::vector<CircleItem> *list, const int x, const int y, const int r, const int value);
 };
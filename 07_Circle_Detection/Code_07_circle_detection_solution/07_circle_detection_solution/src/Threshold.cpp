@@ -24,7 +24,6 @@ void Threshold::loop(const cv::Mat &input, cv::Mat &output, uchar threshold)
     int rows = input.rows;
     int cols = input.cols;
 
-    output.release();
     output.create(rows, cols, CV_8U);
 
     for (int r = 0; r < rows; ++r)
@@ -47,10 +46,9 @@ void Threshold::loop_ptr(const cv::Mat &input, cv::Mat &output, uchar threshold)
     int rows = input.rows;
     int cols = input.cols;
 
-    output.release();
     output.create(rows, cols, CV_8U);
 
-    if (input.isContinuous())
+    if (input.isContinuous() && output.isContinuous())
     {
 
     }
@@ -79,10 +77,9 @@ void Threshold::loop_ptr2(const cv::Mat &input, cv::Mat &output, uchar threshold
     int rows = input.rows;
     int cols = input.cols;
 
-    output.release();
     output.create(rows, cols, CV_8U);
 
-    if (input.isContinuous())
+    if (input.isContinuous() && output.isContinuous())
     {
         cols = rows*cols;
         rows = 1;
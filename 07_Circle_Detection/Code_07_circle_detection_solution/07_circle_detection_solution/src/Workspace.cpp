@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <iostream>
+#include <string.h>
+
+#include "Workspace.h"
+
+Workspace::Workspace()
+    : nextBuffer(0), allocations(0), overflowReported(false)
+{}
+
+Workspace::~Workspace()
+{}
+
+///////////////////////////////////////////////////////////////////////////////
+// start a new frame: all buffers can be handed out again
+///////////////////////////////////////////////////////////////////////////////
+void Workspace::beginFrame()
+{
+    nextBuffer = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// return the next buffer of the pool with the requested shape. The content
+// is undefined; the buffer stays valid until the next beginFrame()
+///////////////////////////////////////////////////////////////////////////////
+cv::Mat Workspace::acquire(int rows, int cols, int type)
+{
+    if (nextBuffer == maxBuffers)
+    {
+        if (!overflowReported)
+        {
+            std::cout << "Workspace: more than " << maxBuffers
+                      << " temporaries in one frame, call beginFrame() once per frame!" << std::endl;
+            overflowReported = true;
+        }
+        ++allocations;
+        return cv::Mat(rows, cols, type);
+    }
+
+    if (nextBuffer == buffers.size())
+        buffers.push_back(cv::Mat());
+
+    cv::Mat &buffer = buffers[nextBuffer++];
+
+    if (buffer.rows != rows || buffer.cols != cols || buffer.type() != type)
+    {
+        buffer.create(rows, cols, type);
+        ++allocations;
+    }
+
+    return buffer;
+}
+
+int Workspace::getAllocations() const
+{
+    return allocations;
+}
+
+void Workspace::prepareOutput(const cv::Mat &input, cv::Mat &output, int rows, int cols, int type)
+{
+    if (!output.empty() && output.data == input.data)
+        output.release();
+
+    // create() keeps the buffer if size and type did not change
+    output.create(rows, cols, type);
+}
+
+void Workspace::clearBorder(cv::Mat &image, int top, int bottom, int left, int right)
+{
+    int rows = image.rows;
+    int cols = image.cols;
+    size_t pixelSize = image.elemSize();
+
+    top = std::min(std::max(top, 0), rows);
+    bottom = std::min(std::max(bottom, 0), rows - top);
+    left = std::min(std::max(left, 0), cols);
+    right = std::min(std::max(right, 0), cols - left);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        uchar *pImage = image.ptr<uchar>(r);
+
+        if (r < top || r >= rows - bottom)
+        {
+            memset(pImage, 0, cols * pixelSize);
+        }
+        else
+        {
+            memset(pImage, 0, left * pixelSize);
+            memset(pImage + (cols - right) * pixelSize, 0, right * pixelSize);
+        }
+    }
+}
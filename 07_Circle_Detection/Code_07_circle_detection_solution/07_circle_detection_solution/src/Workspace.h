@@ -0,0 +1,45 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+// frame-scoped pool for temporary images. Call beginFrame() once per frame;
+// acquire() then hands out the pooled buffers in the order of the requests.
+// As long as every frame requests the same shapes in the same order, no
+// buffer is allocated after the first frame. A frame gets at most
+// maxBuffers pooled buffers; further requests (beginFrame() missing) are
+// served by unpooled images, so the pool cannot grow without bound
+///////////////////////////////////////////////////////////////////////////////
+class Workspace
+{
+public:
+    Workspace();
+
+    ~Workspace();
+
+    static const size_t maxBuffers = 256;
+
+    void beginFrame();
+    cv::Mat acquire(int rows, int cols, int type);
+
+    // number of buffers (re)allocated since construction
+    int getAllocations() const;
+
+    // create() the output unless it shares its data with the input, which a
+    // neighbourhood operator must not overwrite while reading it
+    static void prepareOutput(const cv::Mat &input, cv::Mat &output, int rows, int cols, int type);
+
+    // set the pixels outside the written area to zero
+    static void clearBorder(cv::Mat &image, int top, int bottom, int left, int right);
+
+private:
+    std::vector<cv::Mat> buffers;
+    size_t nextBuffer;
+    int allocations;
+    bool overflowReported;
+};
+
+#endif /* WORKSPACE_H */
@@ -15,6 +15,7 @@
 #include "Morphology.h"
 #include "Segmentation.h"
 #include "Timer.h"
+#include "Workspace.h"
 #include "imshow_multiple.h"
 
 
@@ -33,6 +34,10 @@ int main(int argc, char *argv[])
     Morphology *morphology = new Morphology();
     Segmentation *segmentation = new Segmentation();
 
+    // temporaries of the morphology operations, reused from frame to frame
+    Workspace workspace;
+    morphology->setWorkspace(&workspace);
+
 
     // default step sizes
     float cellStep = 1.0f;  // size of accumulator cell
@@ -273,26 +278,63 @@ int main(int argc, char *argv[])
         // 2. find edges
         // 3. find eyes with Circle Hough Transformation
         // 4. draw the found circles into the original image (and show the image)
+        //
+        // steps 1 - 3 run on every frame of a tracking sequence (here the same image
+        // several times). The output images keep their buffers (create() with an
+        // unchanged size) and the morphology temporaries come from the workspace;
+        // both are checked after the last frame
         ////////////////////////////////////////////////////////////////////////////////////
 
-        // step 1
-        cv::Mat imgGray, imgBrightness, imgContrast, imgThresh, imgEroded, imgSubtracted, imgHough, imgResult;
-        cv::cvtColor(imgColor, imgGray, cv::COLOR_BGR2GRAY);
+        cv::Mat imgGray, imgBrightness, imgContrast, imgThresh, imgSubtracted, imgHough, imgResult;
+        int r = 12;
+        int frames = 10;
+        int firstFrameAllocations = 0;
+        bool outputsReallocated = false;
 
-        // adjust brightness and contrast
-        pointOperations->adjustBrightness(imgGray, imgBrightness, 100);
-        pointOperations->adjustContrast(imgBrightness, imgContrast, 2.5);
+        cv::Mat *outputs[] = { &imgGray, &imgBrightness, &imgContrast, &imgThresh, &imgSubtracted, &imgHough };
+        const int nOutputs = sizeof(outputs) / sizeof(outputs[0]);
+        uchar *firstFrameData[nOutputs];
 
-        // threshold
-        threshold->loop_ptr2(imgContrast, imgThresh, 255);
-        
-        // step 2: find edges (substract eroded image from original image)
-        morphology->erode(imgThresh, imgEroded, morphology->getKernelFull(3));
-        morphology->subtract(imgThresh, imgSubtracted, imgEroded);
+        INIT_TIMER
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            workspace.beginFrame();
 
-        // step 3: Hough Transformation
-        int r = 12;
-        segmentation->houghCircle(imgSubtracted, imgHough, r, cellStep, phiStep);
+            // step 1
+            cv::cvtColor(imgColor, imgGray, cv::COLOR_BGR2GRAY);
+
+            // adjust brightness and contrast
+            pointOperations->adjustBrightness(imgGray, imgBrightness, 100);
+            pointOperations->adjustContrast(imgBrightness, imgContrast, 2.5);
+
+            // threshold
+            threshold->loop_ptr2(imgContrast, imgThresh, 255);
+
+            // step 2: find edges (substract eroded image from original image)
+            morphology->boundary(imgThresh, imgSubtracted, morphology->getKernelFull(3));
+
+            // step 3: Hough Transformation
+            segmentation->houghCircle(imgSubtracted, imgHough, r, cellStep, phiStep);
+
+            for (int i = 0; i < nOutputs; ++i)
+            {
+                if (frame == 0)
+                    firstFrameData[i] = outputs[i]->data;
+                else if (outputs[i]->data != firstFrameData[i])
+                    outputsReallocated = true;
+            }
+
+            if (frame == 0)
+                firstFrameAllocations = workspace.getAllocations();
+        }
+        STOP_TIMER(std::to_string(frames) + " frames")
+
+        std::cout << "  workspace allocations: " << firstFrameAllocations << " after the first frame, "
+                  << workspace.getAllocations() << " after " << frames << " frames" << std::endl;
+        if (workspace.getAllocations() != firstFrameAllocations)
+            std::cout << "  temporaries changed after the first frame!" << std::endl;
+        if (outputsReallocated)
+            std::cout << "  output images were reallocated after the first frame!" << std::endl;
 
         // find circles
         imgColor.copyTo(imgResult);